@@ -27,6 +27,12 @@
  * REVISION:
  * 
  * 
+ * 7) Added recorder control lock. ------------------------ 2026-10-19
+ * 6) Added recording timer commands. --------------------- 2026-10-19
+ * 5) Added pre-roll commands. ---------------------------- 2026-10-19
+ * 4) Added recording statistics command. ----------------- 2026-10-19
+ * 3) Added recording segment command. -------------------- 2026-10-19
+ * 2) Added server command extensions. -------------------- 2026-10-19
  * 1) Initial creation. ----------------------------------- 2005-09-19 MG 
  *
  */
@@ -48,6 +54,7 @@
 #define SRC_SERVER_RECSTOP         2
 #define SRC_SERVER_RECRUNNING      3
 #define SRC_SERVER_RECPRECOMMIT    4
+#define SRC_SERVER_RECWRITER       5  // write-behind budget used up, message counts stalls.
 
 #define SRC_PLUG_INP_INIT         22
 #define SRC_PLUG_INP_START        23
@@ -56,9 +63,176 @@
 #define SRC_PLUG_OUT_START        43
 #define SRC_PLUG_OUT_COMMIT       44
 
+/* Server command extensions.
+ * These are not part of cmd-nms.h, they are numbered well clear of 
+ * the range used there. Replies carry the data only, as other GET_ 
+ * commands do. */
+#define CMD_NMS_EXT_BASE              0x0a00
+#define CMD_GET_MEDIA_CACHE_STATS     (CMD_NMS_EXT_BASE + 0)
+#define CMD_MEDIA_INFO_BATCH          (CMD_NMS_EXT_BASE + 1)
+#define CMD_GET_BAD_FILE_STATS        (CMD_NMS_EXT_BASE + 2)
+#define CMD_GET_STOP_LATENCY_STATS    (CMD_NMS_EXT_BASE + 3)
+#define CMD_GET_SCHED_INFO            (CMD_NMS_EXT_BASE + 4)
+#define CMD_GET_REC_WRITER_STATS      (CMD_NMS_EXT_BASE + 5)
+#define CMD_SET_REC_WRITER_BUDGET     (CMD_NMS_EXT_BASE + 6)
+#define CMD_GET_RECORD_SPACE          (CMD_NMS_EXT_BASE + 7)
+#define CMD_GET_RECORD_SEGMENTS       (CMD_NMS_EXT_BASE + 8)
+#define CMD_GET_RECORD_STATS          (CMD_NMS_EXT_BASE + 9)
+#define CMD_SET_PREROLL               (CMD_NMS_EXT_BASE + 10)
+#define CMD_GET_PREROLL               (CMD_NMS_EXT_BASE + 11)
+#define CMD_ADD_REC_TIMER             (CMD_NMS_EXT_BASE + 12)
+#define CMD_REMOVE_REC_TIMER          (CMD_NMS_EXT_BASE + 13)
+#define CMD_GET_REC_TIMERS            (CMD_NMS_EXT_BASE + 14)
+
+typedef struct
+{
+	unsigned int hits;          // lookups served from cache.
+	unsigned int misses;        // lookups that had to parse the file.
+	unsigned int invalidations; // entries dropped since file changed.
+	unsigned int entries;       // entries currently cached.
+} media_cache_stats_t;
+
+typedef struct
+{
+	unsigned int hits;          // files skipped as known unplayable.
+	unsigned int misses;        // files not known to be unplayable.
+	unsigned int invalidations; // entries dropped since file changed.
+	unsigned int entries;       // files currently known unplayable.
+} bad_file_stats_t;
+
+typedef struct
+{
+	unsigned int stops;         // stops measured, STOP and track change.
+	unsigned int lastMs;        // latency of last stop, mili-seconds.
+	unsigned int maxMs;         // worst latency seen, mili-seconds.
+	unsigned int slow;          // stops over the latency budget.
+} stop_latency_stats_t;
+
+/* CMD_GET_SCHED_INFO replies one entry per thread role. */
+typedef struct
+{
+	char         name[16];      // role name, as in scheduling config.
+	int          tid;           // thread scheduled, 0 if none yet.
+	int          policy;        // configured policy, -1 to leave as is.
+	int          priority;      // configured priority.
+	unsigned int cpus;          // configured affinity mask, 0 for any.
+	int          curPolicy;     // policy in effect, -1 if unknown.
+	int          curPriority;   // priority in effect.
+	int          error;         // errno of last apply, 0 if applied.
+} sched_role_info_t;
+
+typedef struct
+{
+	unsigned int budget;        // bytes that may be queued for writing.
+	unsigned int bytes;         // bytes queued now.
+	unsigned int peak;          // most bytes queued.
+	unsigned int frames;        // frames written.
+	unsigned int highWater;     // times queue went above high water mark.
+	unsigned int stalls;        // times recording waited for budget.
+	unsigned int stallMs;       // total time waited, mili-seconds.
+	unsigned int flushes;       // index flushes asked of the plugin.
+} rec_writer_stats_t;
+
+typedef struct
+{
+	unsigned long long freeBytes;  // free disk space when last sampled.
+	unsigned int diskRate;      // disk fill rate, bytes per second.
+	unsigned int recordRate;    // recording part of it, bytes per second.
+	int          secondsLeft;   // till disk is full save finalization, -1 if unknown.
+	unsigned int interval;      // current sampling interval, seconds.
+	unsigned int samples;       // samples taken this recording.
+} rec_space_info_t;
+
+typedef struct
+{
+	unsigned long long totalBytes; // recorded over all segments.
+	unsigned int segmentBytes;  // recorded in current segment.
+	int          segmentSeconds; // length of current segment.
+	int          segments;      // segments of this recording, listed in name.m3u if over one.
+	int          nextReady;     // file of next segment is prepared.
+} rec_segment_info_t;
+
+/* Histograms count in log2 buckets, bucket n counts values from 2^n up to
+ * 2^(n+1), bucket 0 also counts 0 and the last one everything above. */
+#define REC_STATS_BUCKETS  20
+
+typedef struct
+{
+	unsigned int captured;      // frames taken from encoder input.
+	unsigned int committed;     // frames written.
+	unsigned int timeouts;      // encoder input had no frame in time.
+	unsigned int queueFull;     // frames that waited for mux to catch up.
+	unsigned int dropped;       // frames lost, out of memory.
+	unsigned int maxDepth;      // most frames queued for mux.
+} rec_stream_stats_t;
+
+typedef struct
+{
+	rec_stream_stats_t audio;
+	rec_stream_stats_t video;
+	unsigned int commitUs[REC_STATS_BUCKETS]; // plugin commit latency, micro-seconds.
+	unsigned int commitMaxUs;
+	unsigned int avGapMs[REC_STATS_BUCKETS];  // a/v time stamp gap at mux, mili-seconds.
+	unsigned int avGapMaxMs;
+	unsigned int waitMs;        // capture waited for mux in total, mili-seconds.
+	unsigned int seconds;       // since recording started.
+	unsigned int bytesPerSec;   // written, on average.
+	unsigned long long bytes;   // written.
+} rec_stats_t;
+
+/* CMD_SET_PREROLL takes an int, seconds of monitor video kept to start
+ * recordings with, 0 for off. */
+typedef struct
+{
+	int          seconds;       // pre-roll length, 0 if off.
+	unsigned int frames;        // video frames kept now.
+	unsigned int bytes;         // bytes kept now.
+	int          spanMs;        // time they cover, mili-seconds.
+} rec_preroll_info_t;
+
+/* CMD_ADD_REC_TIMER takes a rec_timer_t, fields set by server ignored, 
+ * and replies the int id given to it, -1 if refused. CMD_REMOVE_REC_TIMER 
+ * takes the id, a recording it started is stopped. CMD_GET_REC_TIMERS 
+ * replies every timer held, finished ones until their slot is needed. */
+#define REC_TIMER_SLOTS    32
+#define REC_TIMER_PATH     256
+
+typedef enum
+	{
+		REC_TIMER_PENDING,          // waiting for start.
+		REC_TIMER_WARM,             // prepared for start.
+		REC_TIMER_RECORDING,        // recording started.
+		REC_TIMER_DONE,             // recording ran to its end.
+		REC_TIMER_FAILED            // did not start, see error.
+	} REC_TIMER_STATE;
+
+typedef struct
+{
+	int          id;            // set by server.
+	unsigned int start;         // seconds since the epoch.
+	unsigned int duration;      // seconds.
+	rec_ctrl_t   ctrl;          // as for CMD_RECORD.
+	char         path[REC_TIMER_PATH]; // file name, strftime() format of local start time.
+	char         file[REC_TIMER_PATH]; // file name expanded, set by server.
+	int          state;         // REC_TIMER_xxx, set by server.
+	int          error;         // NMS_SRV_RECORD_ERROR if failed, set by server.
+	int          lateMs;        // recording started late by, mili-seconds, set by server.
+} rec_timer_t;
+
+/* CMD_MEDIA_INFO_BATCH takes a NUL separated list of file paths, or a 
+ * single directory path. One reply is sent per file as its probe completes,
+ * media_probe_result_t followed by the NUL terminated file path. A reply 
+ * without data ends the batch. */
+typedef struct
+{
+	int          status;    // 0 if info is valid.
+	media_info_t info;
+} media_probe_result_t;
+
 /* server side APIs. */
 int      SrvPlayFile(const char*);
 int      SrvPlayDir(const char*);
+int      SrvPlayList(const char*);
 int      SrvPlayHistory(void);
 int      SrvRxCmd(void *);
 void	 SrvPauseUnpause(void);
@@ -81,6 +255,9 @@ void     SrvSetEditmode( int mode );
 int      SrvGetRepeatmode(void);
 void     SrvSetRepeatmode(int);
 int      SrvGetMediaInfo(const char *, void *);
+void     SrvGetMediaCacheStats(media_cache_stats_t *);
+void     SrvGetBadFileStats(bad_file_stats_t *);
+void     SrvGetStopLatencyStats(stop_latency_stats_t *);
 int      SrvGetTotalFiles(void);
 int      SrvGetFileIndex(void);
 int      SrvGetFilePath(int idx, void * pathbuf,const int bufsize);
@@ -98,10 +275,21 @@ void     SrvSetGain(int, int);
 int      SrvGetRecordtime(void);
 void     SrvGetRecordError(NMS_SRV_ERROR_DETAIL * detail);
 unsigned int SrvGetRecordsize(void);
+unsigned long long SrvGetRecordsize64(void);
+void     SrvGetRecordSegments(rec_segment_info_t *);
+void     SrvGetRecordStats(rec_stats_t *);
+void     SrvGetRecordWriterStats(rec_writer_stats_t *);
+void     SrvSetRecordWriterBudget(unsigned int);
+void     SrvGetRecordSpace(rec_space_info_t *);
 int      SrvIsRecording(void);
+unsigned int SrvGetRecordCount(void);
+void     SrvLockRecorder(void);
+void     SrvUnlockRecorder(void);
 int		 SrvGetFFRWLevel(void);
 int		 SrvGetSFRWLevel(void);
 int      SrvStartMonitor(int pid);
+void     SrvSetPreroll(int);
+void     SrvGetPreroll(rec_preroll_info_t *);
 void     SrvStopMonitor(int pid);
 int	   SrvIsMonitorActive(void);
 void	   SrvSetProportions(int);
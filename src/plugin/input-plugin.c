@@ -22,14 +22,22 @@
  *
  * plugin input support module.
  *
+ * Input plugins are not reentrant. Probing, parsing media info and setting
+ * up or finishing the active plugin are serialized by inputMutex, whichever
+ * thread does them, playback or the media info workers.
+ *
  * REVISION:
  * 
+ * 6) Serialize plugin probing and set up. ---------------- 2026-10-19
+ * 5) Select plugins through lookup indexes. -------------- 2026-10-19
+ * 4) Get info from the active plugin without re-probing. - 2026-10-19
  * 3) Proper handling of dm320 locked status -------------- 2007-05-25 nerochiaro
  * 2) Modified plugin controls structure. ----------------- 2006-01-10 MG
  * 1) Initial creation. ----------------------------------- 2005-09-23 MG 
  *
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -44,51 +52,71 @@ media_input_plugin_ctrl_t *  inputPlugin =
 audio_decode_plugin_ctrl_t * adecodePlugin = 
   (audio_decode_plugin_ctrl_t *)AudioDecodePlugin();
 
+static pthread_mutex_t inputMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define LOCK_INPUTMUTEX()   pthread_mutex_lock(&inputMutex)
+#define UNLOCK_INPUTMUTEX() pthread_mutex_unlock(&inputMutex)
+
 /**
- * Check to see if file has associated plugin.
- *
- * @param file
- *        file name.
- * @param params
- *        media parameters.
- * @return
- *        1 if file is supported, otherwise 0.
+ * Find input plugin claiming given file, first in list order.
+ * The plugin that claimed this very file before is probed first, those
+ * ahead of it in the list turned the file down then; should it not claim
+ * the file any more, all others are probed in list order.
  */
-int
-InputIsOurFile( const char * file )
+static media_input_plugin_t * findInput( const char * file )
 {
 	slist_t * head;
 	media_input_plugin_t * ip;
+	media_input_plugin_t * cand;
 	
+	cand = (media_input_plugin_t*)PluginIndexCandidate(inputPlugin, file);
+	if (cand && cand->isOurFile(file)) return cand;
+
 	head = inputPlugin->head;
 	while (head)
 	{
 		ip = (media_input_plugin_t*)head->data;
 		DBGLOG("checking input plugin - %s", ip->brief);
-		if ( ip->isOurFile(file) ) 
+		if ( (ip != cand) && ip->isOurFile(file) ) 
 		{
-			inputPlugin->actv = ip;
-			if(OutputSelect(ip->type)) return 0;
-			else return 1;
+			PluginIndexLearn(inputPlugin, file, ip);
+			return ip;
 		}
 		else head = head->next;
 	}
 	
-	return 0;
+	return NULL;
 }
 
 /**
- * Check to initialize current input plugin.
+ * Check to see if file has associated plugin.
  *
- * @params params
- *         media parameters.
+ * @param file
+ *        file name.
+ * @param params
+ *        media parameters.
  * @return
- *         0 if successful, 1 is dm320 locked, otherwise errors.
+ *        1 if file is supported, otherwise 0.
  */
 int
-InputInit( const char *filename , media_desc_t * mdesc )
+InputIsOurFile( const char * file )
+{
+	media_input_plugin_t * ip;
+	int ret = 0;
+	
+	LOCK_INPUTMUTEX();
+	ip = findInput(file);
+	if (ip)
+	{
+		inputPlugin->actv = ip;
+		if (!OutputSelect(ip->type)) ret = 1;
+	}
+	UNLOCK_INPUTMUTEX();
+	return ret;
+}
+
+static int initInput( const char *filename , media_desc_t * mdesc )
 {
-	slist_t * head;
 	audio_decode_plugin_t * adp;
 	int target_codec;
 	int status = -1;
@@ -128,22 +156,16 @@ InputInit( const char *filename , media_desc_t * mdesc )
 		DBGLOG("searching for audio codec...");
 		//DBGLOG("target codec = %d", target_codec);
 		/* search for audio codec plugin. */
-		head = adecodePlugin->head;
-		while (head)
+		adp = (audio_decode_plugin_t*)PluginIndexFind(adecodePlugin, target_codec);
+		if (adp)
 		{
-			adp = (audio_decode_plugin_t*)head->data;
-			//DBGLOG("\tplugin codec = %d", adp->codec);
-			if ( adp->codec == target_codec ) 
+			adecodePlugin->actv = adp;
+			if (adp->init(&mdesc->adesc))
 			{
-				adecodePlugin->actv = adp;
-				if (adp->init(&mdesc->adesc))
-				{
-					adecodePlugin->actv = NULL;
-					return -1;
-				}
-				return 0;
+				adecodePlugin->actv = NULL;
+				return -1;
 			}
-			else head = head->next;
+			return 0;
 		}
 		DBGLOG("unable to find audio codec!");
 		/* mute audio and play back video.*/
@@ -155,16 +177,37 @@ InputInit( const char *filename , media_desc_t * mdesc )
 	return status;
 }
 
+/**
+ * Check to initialize current input plugin.
+ *
+ * @params params
+ *         media parameters.
+ * @return
+ *         0 if successful, 1 is dm320 locked, otherwise errors.
+ */
+int
+InputInit( const char *filename , media_desc_t * mdesc )
+{
+	int status;
+
+	LOCK_INPUTMUTEX();
+	status = initInput(filename, mdesc);
+	UNLOCK_INPUTMUTEX();
+	return status;
+}
+
 /**
  * Finish current input interface
  */
 void
 InputFinish( void )
 {
+	LOCK_INPUTMUTEX();
 	if (adecodePlugin->actv) 
 		adecodePlugin->actv->finish();
 	if (inputPlugin->actv)
 		inputPlugin->actv->finish();
+	UNLOCK_INPUTMUTEX();
 }
 
 /**
@@ -268,22 +311,39 @@ InputGetData( media_buf_t * buf )
 int
 InputGetInfo( const char * filename, void * minfo)
 {
-	slist_t * head;
 	media_input_plugin_t * ip;
+	int ret = -1;
 	
-	head = inputPlugin->head;
-	while (head)
-	{
-		ip = (media_input_plugin_t*)head->data;
-		//DBGLOG("checking input plugin - %s", ip->brief);
-		if ( ip->isOurFile(filename) ) 
-		{
-			return ip->getInfo(filename, (media_info_t*)minfo);
-		}
-		else head = head->next;
-	}
-	
-	return -1;
+	LOCK_INPUTMUTEX();
+	ip = findInput(filename);
+	if (ip) ret = ip->getInfo(filename, (media_info_t*)minfo);
+	UNLOCK_INPUTMUTEX();
+	return ret;
+}
+
+/**
+ * Get media info from the active input plugin.
+ *
+ * Unlike InputGetInfo(), plugins are not probed again, the one selected 
+ * by InputIsOurFile() parses the file.
+ *
+ * @param filename
+ *        input file name.
+ * @param minfo
+ *        input media_info_t struct.
+ * @return 
+ *        0 if get info success,otherwise failed
+ */
+int
+InputGetActiveInfo( const char * filename, void * minfo)
+{
+	int ret = -1;
+
+	LOCK_INPUTMUTEX();
+	if (inputPlugin->actv) 
+		ret = inputPlugin->actv->getInfo(filename, (media_info_t*)minfo);
+	UNLOCK_INPUTMUTEX();
+	return ret;
 }
 
 /**
@@ -322,23 +382,14 @@ static int inNTSC_PAL;
 int
 EncInputSelect( int type )
 {
-	slist_t * head;
 	media_enc_input_plugin_t * eip;
 
 	DBGLOG("selecting input.");
-	head = encInputPlugin->head;
-	while (head)
-	{
-		eip = (media_enc_input_plugin_t*)head->data;
-		if (type == eip->type)
-		{
-			encInputPlugin->actv = eip;
-			return 0;
-		}
-		else head = head->next;
-	}
+	eip = (media_enc_input_plugin_t*)PluginIndexFind(encInputPlugin, type);
+	if (!eip) return -1;
 
-	return -1;
+	encInputPlugin->actv = eip;
+	return 0;
 }
 
 /**
@@ -0,0 +1,125 @@
+/*
+ *  Copyright(C) 2005 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Hash shared by the lookup tables and record checksums, FNV-1a 32 bits,
+ * and the bucket chains most of the tables use.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include "nms-hash.h"
+
+/**
+ * Hash a block of bytes.
+ *
+ * @param data
+ *        bytes to hash.
+ * @param len
+ *        byte count.
+ * @param h
+ *        NMS_HASH_SEED, or hash of bytes coming before.
+ * @return
+ *        hash.
+ */
+unsigned int
+NmsHash( const void * data, int len, unsigned int h )
+{
+	const unsigned char * p = (const unsigned char *)data;
+
+	while (len--)
+	{
+		h ^= *p++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/**
+ * Hash a NUL terminated string.
+ *
+ * @param s
+ *        string to hash.
+ * @return
+ *        hash.
+ */
+unsigned int
+NmsHashString( const char * s )
+{
+	unsigned int h = NMS_HASH_SEED;
+
+	while (*s)
+	{
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/**
+ * Link an entry into its bucket.
+ *
+ * @param bucket
+ *        bucket heads.
+ * @param buckets
+ *        bucket count.
+ * @param chain
+ *        link per entry.
+ * @param e
+ *        entry index.
+ * @param h
+ *        entry hash.
+ */
+void
+NmsChainAdd( short * bucket, int buckets, short * chain, int e, unsigned int h )
+{
+	short * pe = &bucket[h % buckets];
+
+	chain[e] = *pe;
+	*pe = e;
+}
+
+/**
+ * Unlink an entry from its bucket, if linked.
+ *
+ * @param bucket
+ *        bucket heads.
+ * @param buckets
+ *        bucket count.
+ * @param chain
+ *        link per entry.
+ * @param e
+ *        entry index.
+ * @param h
+ *        hash entry was linked with.
+ */
+void
+NmsChainRemove( short * bucket, int buckets, short * chain, int e, unsigned int h )
+{
+	short * pe = &bucket[h % buckets];
+
+	while ((*pe != -1) && (*pe != e)) pe = &chain[*pe];
+	if (*pe == e) *pe = chain[e];
+}
@@ -0,0 +1,44 @@
+#ifndef NMS_HASH__H
+#define NMS_HASH__H
+/*
+ *  Copyright(C) 2005 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Shared hash header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define NMS_HASH_SEED   2166136261u
+
+unsigned int NmsHash(const void *, int, unsigned int);
+unsigned int NmsHashString(const char *);
+
+/* chained buckets over a table of entries, bucket heads and a link per 
+ * entry, -1 ends a chain. */
+void NmsChainAdd(short *, int, short *, int, unsigned int);
+void NmsChainRemove(short *, int, short *, int, unsigned int);
+
+#endif /* NMS_HASH__H */
@@ -24,6 +24,9 @@
  *
  * REVISION:
  * 
+ * 5) Pick up encoder output flush extension. ----------- 2026-10-19
+ * 4) Pick up encoder requirements extension. ----------- 2026-10-19
+ * 3) Build plugin lookup indexes after loading. ---------- 2026-10-19
  * 2) Added in encoder interfaces. ------------------------ 2006-01-10 MG
  * 1) Initial creation. ----------------------------------- 2005-09-23 MG 
  *
@@ -42,8 +45,6 @@
 #include "nc-err.h"
 
 
-#define NUM_PLUGINS     7
-
 typedef void * (*pf_t) (void);
 
 slist_t * libHead;
@@ -87,7 +88,7 @@ static void AddLib( void * lib )
 	else libHead = libTail = list;
 }
 
-static void LoadPlugin( int plugin, void * ld )
+static void * LoadPlugin( int plugin, void * ld )
 {
 	void * p;
 	slist_t * list;
@@ -106,6 +107,7 @@ static void LoadPlugin( int plugin, void * ld )
 	
 	mediaPlugins[plugin].head = head;
 	mediaPlugins[plugin].tail = tail;
+	return p;
 }
 
 /**
@@ -151,7 +153,15 @@ PluginLoad( void )
 				if (ld)
 				{
 					DBGLOG("found symbol: %s", PLUGIN_TAB[i]);
-					LoadPlugin(i, ld);
+					ld = LoadPlugin(i, ld);
+					if (EncOutputPlugin() == &mediaPlugins[i])
+					{
+						void * req = dlsym(lib, NMS_PLUGIN_SYMBOL_ENCOUTPUT_REQ);
+						void * flush = dlsym(lib, NMS_PLUGIN_SYMBOL_ENCOUTPUT_FLUSH);
+
+						if (req) EncOutputExportRequirements(ld, (enc_output_req_t)req);
+						if (flush) EncOutputExportFlush(ld, (enc_output_flush_t)flush);
+					}
 					break;
 				}
 				else i++;
@@ -176,6 +186,7 @@ PluginLoad( void )
 		ERRLOG("Input/output plugins are mandatory!");
 		return -1;
 	}
+	PluginIndexBuild();
 	DBGLOG("plugins loaded!");
 	return 0;
 }
@@ -189,6 +200,7 @@ PluginUnload( void )
 	slist_t * head;
 	int ii;
 	
+	PluginIndexClear();
 	while (libHead)
 	{
 		dlclose(libHead->data);
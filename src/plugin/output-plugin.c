@@ -24,6 +24,10 @@
  *
  * REVISION:
  * 
+ * 8) Encoder output always chosen in list order. -------- 2026-10-19
+ * 7) Flush encoder index through plugin extension. ------ 2026-10-19
+ * 6) Track encoder requirements without a call per frame. 2026-10-19
+ * 5) Select plugins through lookup indexes. -------------- 2026-10-19
  * 4) Added support for setting output proportions -------- 2008-04-10 nerochiaro
  * 3) Added in background preference support. ------------- 2007-08-07 MG
  * 2) Added encoder interfaces. --------------------------- 2006-01-09 MG
@@ -33,6 +37,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "nmsplugin.h"
 #include "plugin-internals.h"
@@ -58,23 +63,14 @@ media_output_plugin_ctrl_t * outputPlugin =
 int
 OutputSelect( int type )
 {
-	slist_t * head;
 	media_output_plugin_t * op;
 
-	head = outputPlugin->head;
-	while (head)
-	  {
-		op = (media_output_plugin_t*)head->data;
-		DBGLOG("checking output plugin - %s", op->brief);
-		if (type == op->type)
-		  {
-			outputPlugin->actv = op;
-			return 0;
-		  }
-		else head = head->next;
-	  }
+	op = (media_output_plugin_t*)PluginIndexFind(outputPlugin, type);
+	if (!op) return -1;
 
-	return -1;
+	DBGLOG("selected output plugin - %s", op->brief);
+	outputPlugin->actv = op;
+	return 0;
 }
 
 /**
@@ -282,6 +278,113 @@ media_enc_output_plugin_ctrl_t * encOutputPlugin =
 audio_encode_plugin_ctrl_t * aencodePlugin = 
   (audio_encode_plugin_ctrl_t *)AudioEncodePlugin();
 
+/* Requirements are tracked on commit: read from the plugin's exported 
+ * counters, or else sampled every ENC_REQ_SAMPLE_FRAMES commits and 
+ * extrapolated in between by the worst growth per commit seen. */
+#define MAX_EXPORTS 8
+
+static struct
+{
+	void *                                    plugin;
+	const volatile encoding_requirements_t *  req;
+	enc_output_flush_t                        flush;
+} exports[MAX_EXPORTS];
+static int                                exportCnt;
+static const volatile encoding_requirements_t * actvReq; // exported by active plugin.
+static enc_output_flush_t                 actvFlush;     // exported by active plugin.
+static encoding_requirements_t            tracked;
+static unsigned int                       sampledFinal;  // finalization last sampled.
+static unsigned int                       perCommit;     // finalization growth per commit.
+static unsigned int                       commits;       // commits since last sample.
+
+static void trackReset( void )
+{
+	int ii;
+
+	actvReq = NULL;
+	actvFlush = NULL;
+	for (ii = 0; ii < exportCnt; ii++)
+		if (exports[ii].plugin == encOutputPlugin->actv)
+		{
+			actvReq = exports[ii].req;
+			actvFlush = exports[ii].flush;
+		}
+
+	encOutputPlugin->actv->getRequirements(&tracked);
+	sampledFinal = tracked.finalization;
+	perCommit = 0;
+	commits = 0;
+}
+
+static void trackCommit( void )
+{
+	unsigned int growth;
+
+	if (actvReq)
+	{
+		tracked.disk_scratch_space = actvReq->disk_scratch_space;
+		tracked.finalization = actvReq->finalization;
+		return;
+	}
+
+	if (++commits < ENC_REQ_SAMPLE_FRAMES)
+	{
+		tracked.finalization += perCommit;
+		return;
+	}
+
+	encOutputPlugin->actv->getRequirements(&tracked);
+	growth = (tracked.finalization > sampledFinal)? 
+		(tracked.finalization - sampledFinal + commits - 1) / commits : 0;
+	// follow growth up at once, down slowly.
+	perCommit = (growth >= perCommit)? growth : (perCommit * 3 + growth) / 4;
+	sampledFinal = tracked.finalization;
+	commits = 0;
+}
+
+// export entry of a plugin, added if new; -1 if table is full.
+static int exportEntry( void * plugin )
+{
+	int ii;
+
+	for (ii = 0; ii < exportCnt; ii++)
+		if (exports[ii].plugin == plugin) return ii;
+	if (exportCnt == MAX_EXPORTS) return -1;
+	memset(&exports[exportCnt], 0, sizeof(exports[0]));
+	exports[exportCnt].plugin = plugin;
+	return exportCnt++;
+}
+
+/**
+ * Register requirements exported by an encoder output plugin.
+ *
+ * @param plugin
+ *        plugin as loaded.
+ * @param get
+ *        exported function returning requirements kept by the plugin.
+ */
+void EncOutputExportRequirements( void * plugin, enc_output_req_t get )
+{
+	int ii = exportEntry(plugin);
+
+	if (ii >= 0) exports[ii].req = get();
+}
+
+/**
+ * Register index flush exported by an encoder output plugin.
+ *
+ * @param plugin
+ *        plugin as loaded.
+ * @param flush
+ *        exported flush function.
+ */
+void EncOutputExportFlush( void * plugin, enc_output_flush_t flush )
+{
+	int ii = exportEntry(plugin);
+
+	if (ii >= 0) exports[ii].flush = flush;
+}
+
 
 /**
  * Check if any encoder ouput plugin can handle the specified recording parameters
@@ -301,6 +404,8 @@ int EncOutputIsOurFormat( rec_ctrl_t* ctrl, void * fname, media_desc_t * mdesc)
 	media_enc_output_plugin_t * eop;
 	int ret = 0;
 
+	// claims depend on the controls as much as the file name, nothing 
+	// learned from an earlier file holds, always asked in list order.
 	head = encOutputPlugin->head;
 	while (head)
 	{
@@ -337,7 +442,6 @@ void EncOutputGetRequirements( encoding_requirements_t * requirements )
  */
 int EncOutputInit( const media_desc_t * mdesc )
 {
-	slist_t * head;
 	audio_encode_plugin_t * aep;
 	int target_codec;
 
@@ -358,18 +462,12 @@ int EncOutputInit( const media_desc_t * mdesc )
 		DBGLOG("searching for audio codec...");
 		DBGLOG("target codec = %d", target_codec);
 		/* search for audio codec plugin. */
-		head = aencodePlugin->head;
-		while (head)
+		aep = (audio_encode_plugin_t*)PluginIndexFind(aencodePlugin, target_codec);
+		if (aep)
 		  {
-			aep = (audio_encode_plugin_t*)head->data;
-			DBGLOG("\tplugin codec = %d", aep->codec);
-			if ( aep->codec == target_codec ) 
-			  {
-				aencodePlugin->actv = aep;
-				aep->init(&mdesc->adesc);
-				return 0;
-			  }
-			else head = head->next;
+			aencodePlugin->actv = aep;
+			aep->init(&mdesc->adesc);
+			return 0;
 		  }
 		WARNLOG("unable to find audio codec!");
 		/* use DSP side codec? */
@@ -386,7 +484,55 @@ int EncOutputInit( const media_desc_t * mdesc )
  */
 int EncOutputStart( void )
 {
-    return (encOutputPlugin->actv->start());
+	int ret;
+
+    ret = encOutputPlugin->actv->start();
+	if (!ret) trackReset();
+	return ret;
+}
+
+/**
+ * @return
+ *        nonzero if active plugin can flush its index while recording.
+ */
+int EncOutputCanFlush( void )
+{
+	return (actvFlush != NULL);
+}
+
+/**
+ * Write out index and meta data gathered so far. Call from the thread
+ * committing, between commits.
+ *
+ * @return
+ *        0 if flushed, -1 if plugin can not flush, otherwise plugin error.
+ */
+int EncOutputFlush( void )
+{
+	int ret;
+
+	if (!actvFlush) return -1;
+	ret = actvFlush();
+	if (!ret)
+	{
+		// what finalization needs has just dropped, sample afresh.
+		encOutputPlugin->actv->getRequirements(&tracked);
+		sampledFinal = tracked.finalization;
+		commits = 0;
+	}
+	return ret;
+}
+
+/**
+ * Get encoder requirements as tracked on commit, no plugin call involved.
+ * Call from the thread committing.
+ *
+ * @param requirements
+ *        requirements buffer.
+ */
+void EncOutputTrackedRequirements( encoding_requirements_t * requirements )
+{
+	*requirements = tracked;
 }
 
 /**
@@ -413,7 +559,11 @@ int EncOutputFinish( void )
  */
 int EncOutputCommit(media_buf_t * buf, int timeoffset )
 {
-    return (encOutputPlugin->actv->commit(buf));
+	int ret;
+
+    ret = encOutputPlugin->actv->commit(buf);
+	if (!ret) trackCommit();
+	return ret;
 }
 
 media_capture_plugin_ctrl_t * capturePlugin = 
@@ -0,0 +1,251 @@
+/*
+ *  Copyright(C) 2005 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * plugin lookup indexes.
+ *
+ * Output, encoder input and audio codec plugins are selected by an integer 
+ * type or codec id, these are indexed once at load time. Input plugins can
+ * only be told by probing, for them the plugins of recently seen paths 
+ * are remembered, full path kept, and offered as the first candidate to
+ * probe. A plugin is learned from a walk in list order, so the ones in 
+ * front of it turned that same file down; candidates are still confirmed
+ * by the plugin probe, the index only saves probing the plugins in front.
+ * A plugin claiming one file of an extension says nothing of the next 
+ * one, so extensions are not learned.
+ *
+ * REVISION:
+ * 
+ * 2) Remember paths in full, extensions not learned. ----- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmsplugin.h"
+#include "plugin-internals.h"
+#include "nms-hash.h"
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#define KEY_SLOTS       64      // power of 2, per plugin type.
+#define PATH_MEMO       16
+
+typedef struct
+{
+	int    key;
+	void * plugin;
+} key_slot_t;
+
+typedef struct
+{
+	unsigned int hash;
+	char *       path;
+	void *       plugin;
+} path_memo_t;
+
+static pthread_mutex_t    indexMutex = PTHREAD_MUTEX_INITIALIZER;
+static key_slot_t         keyIdx[NUM_PLUGINS][KEY_SLOTS];
+static path_memo_t        pathMemo[NUM_PLUGINS][PATH_MEMO];
+static int                pathNext[NUM_PLUGINS];
+
+static int pluginKey( int plugin, void * p, int * key )
+{
+	switch (plugin)
+	{
+	case 1: *key = ((media_output_plugin_t *)p)->type; break;
+	case 2: *key = ((audio_decode_plugin_t *)p)->codec; break;
+	case 3: *key = ((media_enc_input_plugin_t *)p)->type; break;
+	case 5: *key = ((audio_encode_plugin_t *)p)->codec; break;
+	default: return -1;
+	}
+	return 0;
+}
+
+static int pluginOf( void * ctrl )
+{
+	return (media_plugin_ctrl_t *)ctrl - mediaPlugins;
+}
+
+/**
+ * Build plugin indexes, after all plugins are loaded.
+ */
+void
+PluginIndexBuild( void )
+{
+	slist_t * head;
+	key_slot_t * slot;
+	int plugin;
+	int key;
+	int ii;
+
+	PluginIndexClear();
+
+	for (plugin = 0; plugin < NUM_PLUGINS; plugin++)
+	{
+		for (head = mediaPlugins[plugin].head; head; head = head->next)
+		{
+			if (pluginKey(plugin, head->data, &key)) break;
+
+			// first plugin in list order wins, as with a list walk.
+			for (ii = 0; ii < KEY_SLOTS; ii++)
+			{
+				slot = &keyIdx[plugin][(key + ii) & (KEY_SLOTS - 1)];
+				if (!slot->plugin)
+				{
+					slot->key = key;
+					slot->plugin = head->data;
+					break;
+				}
+				if (slot->key == key) break;
+			}
+			if (ii == KEY_SLOTS) WARNLOG("plugin index %d is full.", plugin);
+		}
+	}
+	DBGLOG("plugin indexes built.");
+}
+
+/**
+ * Clear plugin indexes.
+ */
+void
+PluginIndexClear( void )
+{
+	int plugin;
+	int ii;
+
+	pthread_mutex_lock(&indexMutex);
+	memset(keyIdx, 0, sizeof(keyIdx));
+	for (plugin = 0; plugin < NUM_PLUGINS; plugin++)
+		for (ii = 0; ii < PATH_MEMO; ii++) free(pathMemo[plugin][ii].path);
+	memset(pathMemo, 0, sizeof(pathMemo));
+	memset(pathNext, 0, sizeof(pathNext));
+	pthread_mutex_unlock(&indexMutex);
+}
+
+/**
+ * Find plugin by type or codec id.
+ *
+ * @param ctrl
+ *        plugin control, one of OutputPlugin(), AudioDecodePlugin(),
+ *        EncInputPlugin() and AudioEncodePlugin().
+ * @param key
+ *        plugin type or codec id.
+ * @return
+ *        plugin if found, otherwise NULL.
+ */
+void *
+PluginIndexFind( void * ctrl, int key )
+{
+	key_slot_t * slot;
+	int plugin = pluginOf(ctrl);
+	int ii;
+
+	for (ii = 0; ii < KEY_SLOTS; ii++)
+	{
+		slot = &keyIdx[plugin][(key + ii) & (KEY_SLOTS - 1)];
+		if (!slot->plugin) break;
+		if (slot->key == key) return slot->plugin;
+	}
+	return NULL;
+}
+
+/**
+ * Get the first plugin worth probing for a file.
+ *
+ * @param ctrl
+ *        plugin control, InputPlugin().
+ * @param path
+ *        file path.
+ * @return
+ *        candidate plugin, NULL if none is known.
+ */
+void *
+PluginIndexCandidate( void * ctrl, const char * path )
+{
+	int plugin = pluginOf(ctrl);
+	unsigned int h = NmsHashString(path);
+	void * p = NULL;
+	int ii;
+
+	pthread_mutex_lock(&indexMutex);
+	for (ii = 0; ii < PATH_MEMO; ii++)
+	{
+		path_memo_t * m = &pathMemo[plugin][ii];
+
+		if (m->path && (m->hash == h) && !strcmp(m->path, path))
+		{
+			p = m->plugin;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&indexMutex);
+	return p;
+}
+
+/**
+ * Remember the plugin that claimed a file, first in list order.
+ *
+ * @param ctrl
+ *        plugin control, InputPlugin().
+ * @param path
+ *        file path.
+ * @param p
+ *        plugin.
+ */
+void
+PluginIndexLearn( void * ctrl, const char * path, void * p )
+{
+	int plugin = pluginOf(ctrl);
+	unsigned int h = NmsHashString(path);
+	path_memo_t * m;
+	char * s;
+	int ii;
+
+	pthread_mutex_lock(&indexMutex);
+	for (ii = 0; ii < PATH_MEMO; ii++)
+	{
+		m = &pathMemo[plugin][ii];
+		if (m->path && (m->hash == h) && !strcmp(m->path, path))
+		{
+			m->plugin = p;
+			goto bail;
+		}
+	}
+
+	s = strdup(path);
+	if (!s) goto bail;
+	m = &pathMemo[plugin][pathNext[plugin]];
+	pathNext[plugin] = (pathNext[plugin] + 1) % PATH_MEMO;
+	free(m->path);
+	m->hash = h;
+	m->path = s;
+	m->plugin = p;
+
+ bail:
+	pthread_mutex_unlock(&indexMutex);
+}
@@ -26,6 +26,9 @@
  *
  * REVISION:
  * 
+ * 7) Added encoder output flush extension. ------------- 2026-10-19
+ * 6) Added encoder requirements tracking. -------------- 2026-10-19
+ * 5) Added plugin lookup indexes. ------------------------ 2026-10-19
  * 4) Added support for setting output proportions -------- 2008-04-10 nerochiaro 
  * 3) Added in background preference support. ------------- 2007-08-07 MG
  * 2) Added in encoder data structures. ------------------- 2006-01-09 MG
@@ -105,6 +108,7 @@ typedef struct
  * Do NOT change this reference without looking at "PLUGIN_TAB" 
  * definition in nms-plugin.c.
  */
+#define NUM_PLUGINS     7
 extern media_plugin_ctrl_t mediaPlugins[];
 #define InputPlugin()       (&mediaPlugins[0])
 #define OutputPlugin()      (&mediaPlugins[1])
@@ -114,10 +118,32 @@ extern media_plugin_ctrl_t mediaPlugins[];
 #define AudioEncodePlugin() (&mediaPlugins[5])
 #define CapturePlugin()     (&mediaPlugins[6])
 
+/* Optional encoder output extension. A plugin library may export this 
+ * symbol next to its plugin symbol: a function returning requirements 
+ * the plugin keeps up to date as it commits, so they are read without 
+ * a plugin call. Plugins without it are sampled every few commits. */
+#define NMS_PLUGIN_SYMBOL_ENCOUTPUT_REQ  "nms_enc_output_requirements"
+typedef const volatile encoding_requirements_t * (*enc_output_req_t)(void);
+#define ENC_REQ_SAMPLE_FRAMES  64   // commits between samples, if not exported.
+
+/* Optional encoder output extension. A plugin library may export this 
+ * symbol to write out index and meta data gathered so far, partial sample
+ * tables or a movie fragment, and release the memory held for them. It 
+ * is called between commits, returns 0 if done. Finalization then only 
+ * has to cover what was committed since. */
+#define NMS_PLUGIN_SYMBOL_ENCOUTPUT_FLUSH  "nms_enc_output_flush"
+typedef int (*enc_output_flush_t)(void);
+
 
 int             PluginLoad(void);
 void            PluginUnload(void);
 
+void            PluginIndexBuild(void);
+void            PluginIndexClear(void);
+void *          PluginIndexFind(void *, int);
+void *          PluginIndexCandidate(void *, const char *);
+void            PluginIndexLearn(void *, const char *, void *);
+
 int             InputIsOurFile(const char *);
 int             InputInit(const char *,media_desc_t*);
 void            InputFinish(void);
@@ -125,6 +151,7 @@ int             InputStart(const char*);
 int             InputGetData(media_buf_t*);
 int             InputSeek(int);
 int             InputGetInfo(const char *, void *);
+int             InputGetActiveInfo(const char *, void *);
 int             InputGetCapability(input_capability_t *);
 
 int             OutputSelect(int);
@@ -162,6 +189,11 @@ int             EncOutputStart(void);
 int             EncOuputFinish(void);
 int             EncOutputCommit(media_buf_t *, int);
 void            EncOutputGetRequirements( encoding_requirements_t * requirements );
+void            EncOutputTrackedRequirements( encoding_requirements_t * requirements );
+void            EncOutputExportRequirements(void *, enc_output_req_t);
+void            EncOutputExportFlush(void *, enc_output_flush_t);
+int             EncOutputCanFlush(void);
+int             EncOutputFlush(void);
 
 int             CaptureInit( capture_desc_t * cadesc );
 int             CaptureGetFrame( frame_desc_t * fdesc );
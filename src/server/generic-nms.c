@@ -24,6 +24,12 @@
  *
  * REVISION:
  * 
+ * 8) Sync play history from the command loop. --------- 2026-10-19
+ * 7) Save state on signals out of the handler. -------- 2026-10-19
+ * 6) Run recording timers. ---------------------------- 2026-10-19
+ * 5) Load and restore thread scheduling policy. ------- 2026-10-19
+ * 4) Restore and save directory listing cache. ----------- 2026-10-19
+ * 3) Restore and save media info cache. ------------------ 2026-10-19
  * 2) Embedded cmd ACK with returned data if any. --------- 2006-04-14 MG
  * 1) Initial creation. ----------------------------------- 2005-09-19 MG 
  *
@@ -40,9 +46,15 @@
 #include "plugin-internals.h"
 #include "cooler-core.h"
 #include "server-monitor-internal.h"
+#include "server-play-history.h"
+#include "server-media-cache.h"
+#include "server-dir-cache.h"
+#include "server-sched.h"
+#include "server-rec-timer.h"
 
 static int       sessionId;
 static int       cmdFd;
+static volatile sig_atomic_t caught; // signal asking to stop, 0 if none.
 
 /*
  * Set up the command interface.
@@ -114,7 +126,9 @@ SrvCmdStart( void )
 	struct sockaddr_un saddr;		
 	pkt_node_t         pkt;
 
-	while ( 1 )
+	SchedApply(SR_COMMAND);
+
+	while ( !caught )
 	{
 		//NOTSURE: maybe we should move this out of the loop, see comment in
 		//         in client-nms.c.
@@ -123,6 +137,8 @@ SrvCmdStart( void )
 		tv.tv_sec = 0;
 		tv.tv_usec = 100000;
 		len = sizeof(saddr);
+		// loop comes by at least every select() timeout.
+		PlayHistoryTick();
 		if ((select(cmdFd + 1, &set, NULL, NULL, &tv) <= 0) ||
 		    ((fd = accept(cmdFd, (struct sockaddr *)&saddr, &len)) == -1))
 			continue;
@@ -149,14 +165,22 @@ SrvCmdStart( void )
 	}
 
 	// stop server.
+	if (caught) WARNLOG("------- signal caught:[%d] --------\n", caught);
 	SrvCmdStop(sessionId);
 	SrvStopMonitorGarbageCollector();
+	PlayHistoryFlush();
+	MediaCacheSave();
+	DirCacheSave();
+	SchedRestoreAll();
 }
 
+/*
+ * Only flags the signal, the command loop notices within its select()
+ * timeout and saves state on its way out, where locks can be taken.
+ */
 static void signal_handler(int signum)
 {
-	WARNLOG("------- signal caught:[%d] --------\n", signum);
-	exit(0);
+	caught = signum;
 }
 
 static void signal_init(void)
@@ -189,6 +213,12 @@ NmsSrvInit(int argc, char** argv)
 	/* load various plugins. */
 	PluginLoad();
 
+	/* bookmarks survive restarts. */
+	PlayHistoryInit();
+	MediaCacheInit();
+	DirCacheInit();
+	SchedInit();
+
 	signal_init();
 
 	for ( ii = 0;; ii++ ) 
@@ -227,6 +257,9 @@ NmsSrvInit(int argc, char** argv)
 		else break;
 	}
 
+	/* recordings set ahead start by themselves. */
+	TimerInit();
+
 	sessionId = ii;
 	return 0;
 }
@@ -0,0 +1,210 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms unplayable file cache.
+ *
+ * Files that failed to play for a reason of their own, not for the state 
+ * of output device, are remembered with the size and modification time 
+ * they had, so directory playback can step over them without paying for
+ * another failed open. An entry is forgotten as soon as its file changes.
+ * Slots are reused round robin once the cache is full.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-bad-files.h"
+#include "nms-hash.h"
+
+#define BUCKETS        1024
+#define NIL            (-1)
+
+typedef struct
+{
+	unsigned int  hash;
+	int           reason;   // 0 if slot is free.
+	long long     size;
+	long long     mtime;
+	char          path[BAD_FILE_PATH_MAX];
+} bad_file_t;
+
+static pthread_mutex_t    badMutex = PTHREAD_MUTEX_INITIALIZER;
+static bad_file_t         entries[BAD_FILE_ENTRIES];
+static short              bucket[BUCKETS];
+static short              chain[BAD_FILE_ENTRIES];
+static int                hand;
+static int                inited;
+static bad_file_stats_t   stats;
+
+static void init( void )
+{
+	memset(bucket, NIL, sizeof(bucket));
+	inited = 1;
+}
+
+static int find( const char * path, unsigned int h )
+{
+	int e;
+
+	for (e = bucket[h % BUCKETS]; e != NIL; e = chain[e])
+	{
+		if ((entries[e].hash == h) && !strcmp(entries[e].path, path)) return e;
+	}
+	return NIL;
+}
+
+static void drop( int e )
+{
+	NmsChainRemove(bucket, BUCKETS, chain, e, entries[e].hash);
+	entries[e].reason = 0;
+	stats.entries--;
+}
+
+/**
+ * Tell if a file is known to be unplayable.
+ *
+ * @param path
+ *        file path.
+ * @return
+ *        BF_* reason if file failed before and is unchanged since, 
+ *        otherwise 0.
+ */
+int
+BadFileCheck( const char * path )
+{
+	struct stat st;
+	unsigned int h = NmsHashString(path);
+	int reason = 0;
+	int e;
+
+	pthread_mutex_lock(&badMutex);
+	if (!inited) init();
+
+	e = find(path, h);
+	if (e != NIL)
+	{
+		// file status is only needed for entries we have.
+		if (!stat(path, &st) && 
+			(entries[e].size == (long long)st.st_size) &&
+			(entries[e].mtime == (long long)st.st_mtime))
+		{
+			reason = entries[e].reason;
+		}
+		else
+		{
+			drop(e);
+			stats.invalidations++;
+		}
+	}
+	if (reason) stats.hits++;
+	else stats.misses++;
+	pthread_mutex_unlock(&badMutex);
+
+	return reason;
+}
+
+/**
+ * Remember a file as unplayable.
+ *
+ * @param path
+ *        file path.
+ * @param reason
+ *        BF_* reason.
+ */
+void
+BadFileAdd( const char * path, int reason )
+{
+	struct stat st;
+	unsigned int h = NmsHashString(path);
+	int e;
+
+	if (strlen(path) >= BAD_FILE_PATH_MAX) return;
+	if (stat(path, &st) || !S_ISREG(st.st_mode)) return;
+
+	pthread_mutex_lock(&badMutex);
+	if (!inited) init();
+
+	e = find(path, h);
+	if (e == NIL)
+	{
+		e = hand;
+		hand = (hand + 1) % BAD_FILE_ENTRIES;
+		if (entries[e].reason) drop(e);
+
+		entries[e].hash = h;
+		strcpy(entries[e].path, path);
+		NmsChainAdd(bucket, BUCKETS, chain, e, h);
+		stats.entries++;
+	}
+	entries[e].reason = reason;
+	entries[e].size = st.st_size;
+	entries[e].mtime = st.st_mtime;
+	pthread_mutex_unlock(&badMutex);
+
+	DBGLOG("unplayable file [%s], reason %d.", path, reason);
+}
+
+/**
+ * Forget a file, it played after all.
+ *
+ * @param path
+ *        file path.
+ */
+void
+BadFileClear( const char * path )
+{
+	int e;
+
+	pthread_mutex_lock(&badMutex);
+	if (inited)
+	{
+		e = find(path, NmsHashString(path));
+		if (e != NIL) drop(e);
+	}
+	pthread_mutex_unlock(&badMutex);
+}
+
+/**
+ * Get cache statistics.
+ *
+ * @param s
+ *        statistics buffer.
+ */
+void
+BadFileGetStats( bad_file_stats_t * s )
+{
+	pthread_mutex_lock(&badMutex);
+	memcpy(s, &stats, sizeof(stats));
+	pthread_mutex_unlock(&badMutex);
+}
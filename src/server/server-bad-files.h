@@ -0,0 +1,49 @@
+#ifndef NMS_SERVER_BAD_FILES__H
+#define NMS_SERVER_BAD_FILES__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms unplayable file cache header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include "server-nms.h"
+
+#define BAD_FILE_ENTRIES   512
+#define BAD_FILE_PATH_MAX  260
+
+// why a file was found unplayable.
+#define BF_NOT_OURS        1  // no input plugin claims it.
+#define BF_INPUT_INIT      2  // input plugin failed to parse it.
+#define BF_INPUT_START     3  // input plugin failed to start it.
+
+int  BadFileCheck(const char *);
+void BadFileAdd(const char *, int);
+void BadFileClear(const char *);
+void BadFileGetStats(bad_file_stats_t *);
+
+#endif /* NMS_SERVER_BAD_FILES__H */
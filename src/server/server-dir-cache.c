@@ -0,0 +1,504 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms directory listing cache.
+ *
+ * Filtered and sorted listings of recently played directories are kept, 
+ * keyed by directory and the audio/video filter applied. While cached, a
+ * directory is watched with inotify and its listing is updated entry by 
+ * entry as files come and go, so it never needs to be read again. Cache is
+ * persisted across restarts, a restored listing is trusted only while the
+ * directory modification time is unchanged, until it is watched again.
+ * The time is checked once more after the watch is added, a change 
+ * before it took effect drops the listing.
+ *
+ * REVISION:
+ * 
+ * 2) Check directory unchanged once watched. ------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-dir-cache.h"
+
+#define CACHE_MAGIC    0x444e4d53 // "SMND"
+#define CACHE_VERSION  1
+#define WATCH_MASK     (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+						IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)
+#define EVENT_BUF      4096
+
+typedef struct
+{
+	char          path[PATH_MAX];
+	int           av;         // filter key, 0 if slot is free.
+	dir_filter_t  filter;     // NULL until used since restored.
+	long long     mtime;      // directory modification time listed.
+	int           wd;         // inotify watch, -1 if not watched.
+	time_t        stamp;      // last use.
+	char *        names;      // sorted entry names, NUL separated.
+	int           bytes;
+	int           count;
+} dir_cache_t;
+
+static pthread_mutex_t    cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static dir_cache_t        dirs[DIR_CACHE_DIRS];
+static int                inotifyFd = -1;
+static pthread_t          watchThread;
+
+#define LOCK_CMUTEX()   pthread_mutex_lock(&cacheMutex)
+#define UNLOCK_CMUTEX() pthread_mutex_unlock(&cacheMutex)
+
+static long long dirMtime( const char * path )
+{
+	struct stat st;
+
+	if (stat(path, &st) || !S_ISDIR(st.st_mode)) return -1;
+	return st.st_mtime;
+}
+
+static void unwatch( dir_cache_t * d )
+{
+	int ii;
+
+	if (d->wd < 0) return;
+
+	// watch is shared by listings of the same directory.
+	for (ii = 0; ii < DIR_CACHE_DIRS; ii++)
+	{
+		if ((&dirs[ii] != d) && dirs[ii].av && (dirs[ii].wd == d->wd)) break;
+	}
+	if ((ii == DIR_CACHE_DIRS) && (inotifyFd >= 0)) inotify_rm_watch(inotifyFd, d->wd);
+	d->wd = -1;
+}
+
+static void drop( dir_cache_t * d )
+{
+	unwatch(d);
+	free(d->names);
+	memset(d, 0, sizeof(dir_cache_t));
+	d->wd = -1;
+}
+
+// watch listing, dropped if the directory changed before the watch.
+static int watch( dir_cache_t * d )
+{
+	if ((d->wd >= 0) || (inotifyFd < 0)) return 0;
+
+	d->wd = inotify_add_watch(inotifyFd, d->path, WATCH_MASK);
+	if (d->wd < 0) WPRINT("unable to watch directory [%s].", d->path);
+	if (dirMtime(d->path) != d->mtime)
+	{
+		drop(d);
+		return -1;
+	}
+	return 0;
+}
+
+static dir_cache_t * find( const char * path, int av )
+{
+	int ii;
+
+	for (ii = 0; ii < DIR_CACHE_DIRS; ii++)
+	{
+		if ((dirs[ii].av == av) && !strcmp(dirs[ii].path, path)) return &dirs[ii];
+	}
+	return NULL;
+}
+
+static int findName( const dir_cache_t * d, const char * name, int * at )
+{
+	const char * s = d->names;
+	int off = 0;
+	int c;
+
+	// entries are few enough for a walk, done only on directory changes.
+	while (off < d->bytes)
+	{
+		c = strcmp(s + off, name);
+		if (c >= 0)
+		{
+			*at = off;
+			return !c;
+		}
+		off += strlen(s + off) + 1;
+	}
+	*at = off;
+	return 0;
+}
+
+static void addName( dir_cache_t * d, const char * name )
+{
+	char path[PATH_MAX];
+	struct stat st;
+	char * p;
+	int len = strlen(name) + 1;
+	int at;
+
+	if ((name[0] == '.') || !d->filter || !d->filter(name)) return;
+	snprintf(path, PATH_MAX, "%s/%s", d->path, name);
+	if (stat(path, &st) || !S_ISREG(st.st_mode)) return;
+	if (findName(d, name, &at)) return;
+
+	p = realloc(d->names, d->bytes + len);
+	if (!p) 
+	{
+		drop(d);
+		return;
+	}
+	d->names = p;
+	memmove(p + at + len, p + at, d->bytes - at);
+	memcpy(p + at, name, len);
+	d->bytes += len;
+	d->count++;
+}
+
+static void removeName( dir_cache_t * d, const char * name )
+{
+	int len = strlen(name) + 1;
+	int at;
+
+	if (!findName(d, name, &at)) return;
+	memmove(d->names + at, d->names + at + len, d->bytes - at - len);
+	d->bytes -= len;
+	d->count--;
+}
+
+static void applyEvent( const struct inotify_event * ev )
+{
+	dir_cache_t * d;
+	int ii;
+
+	for (ii = 0; ii < DIR_CACHE_DIRS; ii++)
+	{
+		d = &dirs[ii];
+		if (!d->av || (d->wd != ev->wd)) continue;
+
+		if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED))
+		{
+			// watch is gone with the directory.
+			d->wd = -1;
+			drop(d);
+			continue;
+		}
+		if (!ev->len) continue;
+
+		if (ev->mask & (IN_CREATE | IN_MOVED_TO)) addName(d, ev->name);
+		else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) removeName(d, ev->name);
+		d->mtime = dirMtime(d->path);
+	}
+}
+
+static void * watchLoop( void * arg )
+{
+	char buf[EVENT_BUF] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event * ev;
+	int len;
+	int off;
+	int ii;
+
+	while (1)
+	{
+		len = read(inotifyFd, buf, sizeof(buf));
+		if (len <= 0) 
+		{
+			if ((len < 0) && (errno == EINTR)) continue;
+			break;
+		}
+
+		LOCK_CMUTEX();
+		for (off = 0; off < len; off += sizeof(struct inotify_event) + ev->len)
+		{
+			ev = (const struct inotify_event *)(buf + off);
+			if (ev->mask & IN_Q_OVERFLOW)
+			{
+				// events were lost, nothing cached can be trusted.
+				WPRINT("directory events lost, cache dropped.");
+				for (ii = 0; ii < DIR_CACHE_DIRS; ii++) 
+					if (dirs[ii].av) drop(&dirs[ii]);
+				continue;
+			}
+			applyEvent(ev);
+		}
+		UNLOCK_CMUTEX();
+	}
+
+	WPRINT("directory watch stopped.");
+	return NULL;
+}
+
+/**
+ * Initialize directory listing cache, restoring persisted listings if any.
+ */
+void
+DirCacheInit( void )
+{
+	int ii;
+
+	LOCK_CMUTEX();
+	for (ii = 0; ii < DIR_CACHE_DIRS; ii++) 
+	{
+		memset(&dirs[ii], 0, sizeof(dir_cache_t));
+		dirs[ii].wd = -1;
+	}
+
+#ifdef DIR_CACHE_FILE
+	{
+		FILE * fp;
+		unsigned int hdr[3];
+		dir_cache_t * d;
+		int len;
+
+		fp = fopen(DIR_CACHE_FILE, "rb");
+		if (fp)
+		{
+			if ((fread(hdr, sizeof(hdr), 1, fp) == 1) && (hdr[0] == CACHE_MAGIC) &&
+				(hdr[1] == CACHE_VERSION))
+			{
+				for (ii = 0; (ii < hdr[2]) && (ii < DIR_CACHE_DIRS); ii++)
+				{
+					d = &dirs[ii];
+					if ((fread(&d->av, sizeof(int), 1, fp) != 1) ||
+						(fread(&d->mtime, sizeof(long long), 1, fp) != 1) ||
+						(fread(&d->count, sizeof(int), 1, fp) != 1) ||
+						(fread(&d->bytes, sizeof(int), 1, fp) != 1) ||
+						(fread(&len, sizeof(int), 1, fp) != 1) ||
+						(len <= 0) || (len > PATH_MAX) || (d->bytes < 0) ||
+						(fread(d->path, len, 1, fp) != 1))
+						break;
+					d->path[len - 1] = 0;
+					d->names = malloc(d->bytes + 1);
+					if (!d->names || (fread(d->names, d->bytes, 1, fp) != 1)) break;
+					d->stamp = time(NULL);
+				}
+				// drop a truncated record.
+				if ((ii < hdr[2]) && (ii < DIR_CACHE_DIRS)) drop(&dirs[ii]);
+			}
+			fclose(fp);
+		}
+		DBGLOG("%d directory listings restored.", ii);
+	}
+#endif
+
+	inotifyFd = inotify_init();
+	if (inotifyFd < 0) WPRINT("inotify not available, directories cached until restart.");
+	else if (pthread_create(&watchThread, NULL, watchLoop, NULL))
+	{
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+	UNLOCK_CMUTEX();
+}
+
+/**
+ * Persist directory listing cache, if persistence is enabled.
+ */
+void
+DirCacheSave( void )
+{
+#ifdef DIR_CACHE_FILE
+	FILE * fp;
+	unsigned int hdr[3];
+	dir_cache_t * d;
+	int ok;
+	int len;
+	int ii;
+
+	LOCK_CMUTEX();
+
+	fp = fopen(DIR_CACHE_FILE ".tmp", "wb");
+	if (!fp) goto bail;
+
+	hdr[0] = CACHE_MAGIC;
+	hdr[1] = CACHE_VERSION;
+	hdr[2] = 0;
+	for (ii = 0; ii < DIR_CACHE_DIRS; ii++) if (dirs[ii].av) hdr[2]++;
+	ok = (fwrite(hdr, sizeof(hdr), 1, fp) == 1);
+
+	for (ii = 0; ok && (ii < DIR_CACHE_DIRS); ii++)
+	{
+		d = &dirs[ii];
+		if (!d->av) continue;
+		len = strlen(d->path) + 1;
+		ok = (fwrite(&d->av, sizeof(int), 1, fp) == 1) &&
+			(fwrite(&d->mtime, sizeof(long long), 1, fp) == 1) &&
+			(fwrite(&d->count, sizeof(int), 1, fp) == 1) &&
+			(fwrite(&d->bytes, sizeof(int), 1, fp) == 1) &&
+			(fwrite(&len, sizeof(int), 1, fp) == 1) &&
+			(fwrite(d->path, len, 1, fp) == 1) &&
+			(!d->bytes || (fwrite(d->names, d->bytes, 1, fp) == 1));
+	}
+
+	ok = !fflush(fp) && !fsync(fileno(fp)) && ok;
+	fclose(fp);
+
+	// replace old copy only once the new one is complete.
+	if (ok) rename(DIR_CACHE_FILE ".tmp", DIR_CACHE_FILE);
+	else unlink(DIR_CACHE_FILE ".tmp");
+
+ bail:
+	UNLOCK_CMUTEX();
+#endif
+}
+
+/**
+ * Look up cached directory listing.
+ *
+ * @param path
+ *        directory path.
+ * @param av
+ *        filter key, nonzero.
+ * @param filter
+ *        file name filter the key stands for.
+ * @param names
+ *        returned copy of sorted entry names, NUL separated, to be freed 
+ *        by caller.
+ * @param bytes
+ *        returned size of names.
+ * @param count
+ *        returned number of entries.
+ * @return
+ *        0 if listing is cached and current, otherwise nonzero.
+ */
+int
+DirCacheLookup( const char * path, int av, dir_filter_t filter, 
+				char ** names, int * bytes, int * count )
+{
+	dir_cache_t * d;
+	int ret = -1;
+
+	LOCK_CMUTEX();
+	d = find(path, av);
+	if (!d) goto bail;
+
+	// restored listing, good while directory is unchanged.
+	if (d->wd < 0)
+	{
+		if (dirMtime(path) != d->mtime)
+		{
+			drop(d);
+			goto bail;
+		}
+		d->filter = filter;
+		if (watch(d)) goto bail;
+	}
+
+	*names = malloc(d->bytes + 1);
+	if (!*names) goto bail;
+	memcpy(*names, d->names, d->bytes);
+	*bytes = d->bytes;
+	*count = d->count;
+	d->stamp = time(NULL);
+	ret = 0;
+
+ bail:
+	UNLOCK_CMUTEX();
+	DBGLOG("directory [%s] %s.", path, ret? "not cached" : "cached");
+	return ret;
+}
+
+/**
+ * Cache a directory listing, just read.
+ *
+ * @param path
+ *        directory path.
+ * @param av
+ *        filter key, nonzero.
+ * @param filter
+ *        file name filter applied.
+ * @param names
+ *        sorted entry names, NUL separated.
+ * @param bytes
+ *        size of names.
+ * @param count
+ *        number of entries.
+ * @param since
+ *        time directory reading started.
+ */
+void
+DirCacheStore( const char * path, int av, dir_filter_t filter,
+			   const char * names, int bytes, int count, time_t since )
+{
+	dir_cache_t * d;
+	long long mtime;
+	int ii;
+
+	if (!av || (strlen(path) >= PATH_MAX)) return;
+
+	// changed while being read, the listing may already be stale. 
+	// FAT keeps time stamps at two seconds granularity.
+	mtime = dirMtime(path);
+	if ((mtime < 0) || (mtime >= (long long)since - 2)) return;
+
+	LOCK_CMUTEX();
+	d = find(path, av);
+	if (!d)
+	{
+		// take a free slot, or the least recently used.
+		d = &dirs[0];
+		for (ii = 0; ii < DIR_CACHE_DIRS; ii++)
+		{
+			if (!dirs[ii].av) 
+			{
+				d = &dirs[ii];
+				break;
+			}
+			if (dirs[ii].stamp < d->stamp) d = &dirs[ii];
+		}
+		drop(d);
+		strcpy(d->path, path);
+		d->av = av;
+	}
+
+	free(d->names);
+	d->names = malloc(bytes + 1);
+	if (!d->names)
+	{
+		drop(d);
+		goto bail;
+	}
+	memcpy(d->names, names, bytes);
+	d->bytes = bytes;
+	d->count = count;
+	d->filter = filter;
+	d->mtime = mtime;
+	d->stamp = time(NULL);
+	if (watch(d)) DBGLOG("directory [%s] changed while cached.", path);
+
+ bail:
+	UNLOCK_CMUTEX();
+}
@@ -0,0 +1,47 @@
+#ifndef NMS_SERVER_DIR_CACHE__H
+#define NMS_SERVER_DIR_CACHE__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms directory listing cache header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <time.h>
+
+#include "server-dir-list.h"
+
+#define DIR_CACHE_DIRS     16
+// comment this out to keep the cache in memory only.
+#define DIR_CACHE_FILE     "/mnt/OSD/.nms-dirs"
+
+void  DirCacheInit(void);
+void  DirCacheSave(void);
+int   DirCacheLookup(const char *, int, dir_filter_t, char **, int *, int *);
+void  DirCacheStore(const char *, int, dir_filter_t, const char *, int, int, time_t);
+
+#endif /* NMS_SERVER_DIR_CACHE__H */
@@ -0,0 +1,519 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms streaming directory listing.
+ *
+ * Directory is read with plain readdir(), matching files are added in 
+ * batches as they are found, the number read so far is reported as it 
+ * grows. Entry names are kept in one string arena, with a hash of names 
+ * to locate a file by path. Once the whole directory is read, entries are
+ * sorted by name: the new order is prepared aside and committed in one 
+ * step, which publishes the listing. Entries are handed out only once 
+ * published, so an index never changes under whoever got it.
+ *
+ * Only one thread scans, it is the only writer of the listing.
+ *
+ * REVISION:
+ * 
+ * 3) Publish entries once sorted. ----------------------- 2026-10-19
+ * 2) Load and export complete listings. ----------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-dir-list.h"
+#include "nms-hash.h"
+
+static pthread_mutex_t    listMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     listCond = PTHREAD_COND_INITIALIZER;
+
+static char               dirPath[PATH_MAX];
+static char *             arena;      // entry names.
+static int                arenaUsed;
+static int                arenaSize;
+static int *              offs;       // name offset per entry.
+static int                count;      // published entries.
+static int                found;      // entries read, published or not.
+static int                capacity;
+static int *              hashTab;    // entry index + 1, 0 if free.
+static int                hashSize;
+static int                done;       // all entries published.
+static int                aborted;
+
+// sorted listing, prepared outside the lock.
+static int *              sortedOffs;
+static int *              sortedHash;
+
+#define LOCK_LMUTEX()   pthread_mutex_lock(&listMutex)
+#define UNLOCK_LMUTEX() pthread_mutex_unlock(&listMutex)
+
+static void hashInsert( int * tab, int size, const int * o, int idx )
+{
+	unsigned int h = NmsHashString(arena + o[idx]);
+
+	while (tab[h & (size - 1)]) h++;
+	tab[h & (size - 1)] = idx + 1;
+}
+
+static int * hashBuild( const int * o, int n, int size )
+{
+	int * tab;
+	int ii;
+
+	tab = calloc(size, sizeof(int));
+	if (!tab) return NULL;
+	for (ii = 0; ii < n; ii++) hashInsert(tab, size, o, ii);
+	return tab;
+}
+
+static int sortCompare( const void * a, const void * b )
+{
+	return strcmp(arena + offs[*(const int *)a], arena + offs[*(const int *)b]);
+}
+
+/**
+ * Drop current listing and get ready to read a directory.
+ *
+ * @param dir
+ *        directory path.
+ */
+void
+DirListReset( const char * dir )
+{
+	int ii;
+
+	LOCK_LMUTEX();
+	free(arena);
+	free(offs);
+	free(hashTab);
+	free(sortedOffs);
+	free(sortedHash);
+	arena = NULL;
+	offs = hashTab = sortedOffs = sortedHash = NULL;
+	arenaUsed = arenaSize = 0;
+	count = found = capacity = hashSize = 0;
+	done = aborted = 0;
+	strncpy(dirPath, dir, PATH_MAX - 1);
+	dirPath[PATH_MAX - 1] = 0;
+	// entry paths are joined with a slash of our own.
+	for (ii = strlen(dirPath) - 1; (ii > 0) && (dirPath[ii] == '/'); ii--) 
+		dirPath[ii] = 0;
+	UNLOCK_LMUTEX();
+}
+
+/**
+ * Stop a scan in progress, and release anyone waiting for entries.
+ */
+void
+DirListAbort( void )
+{
+	LOCK_LMUTEX();
+	aborted = 1;
+	UNLOCK_LMUTEX();
+	pthread_cond_broadcast(&listCond);
+}
+
+// add entries read, published with the sorted listing.
+static int add( const char * names, int bytes, int n )
+{
+	void * p;
+	int need;
+	int ii;
+
+	LOCK_LMUTEX();
+	if (aborted) goto bail;
+
+	if (arenaUsed + bytes > arenaSize)
+	{
+		need = (arenaUsed + bytes) * 2;
+		p = realloc(arena, need);
+		if (!p) goto nomem;
+		arena = p;
+		arenaSize = need;
+	}
+	if (found + n > capacity)
+	{
+		need = (found + n) * 2;
+		p = realloc(offs, need * sizeof(int));
+		if (!p) goto nomem;
+		offs = p;
+		capacity = need;
+	}
+	if ((found + n) * 2 > hashSize)
+	{
+		for (need = hashSize? hashSize : 1024; need < (found + n) * 2; need *= 2);
+		free(hashTab);
+		hashTab = hashBuild(offs, found, need);
+		if (!hashTab) goto nomem;
+		hashSize = need;
+	}
+
+	memcpy(arena + arenaUsed, names, bytes);
+	for (ii = 0; ii < n; ii++)
+	{
+		offs[found] = arenaUsed;
+		arenaUsed += strlen(arena + arenaUsed) + 1;
+		hashInsert(hashTab, hashSize, offs, found);
+		found++;
+	}
+	UNLOCK_LMUTEX();
+	return 0;
+
+ nomem:
+	ERRLOG("out of memory listing directory.");
+	aborted = 1;
+ bail:
+	UNLOCK_LMUTEX();
+	return -1;
+}
+
+/**
+ * Read directory, matching files are published by DirListSortCommit().
+ *
+ * @param filter
+ *        file name filter, nonzero to take the file.
+ * @param progress
+ *        called with number of entries read after each batch, may be NULL.
+ * @return
+ *        number of entries, -1 if scan was aborted.
+ */
+int
+DirListScan( dir_filter_t filter, dir_progress_t progress )
+{
+	DIR * dp;
+	struct dirent * de;
+	struct stat st;
+	char path[PATH_MAX];
+	char batch[DIR_LIST_BATCH * 64];
+	int used = 0;
+	int n = 0;
+	int total = 0;
+	int len;
+	int ret = -1;
+
+	dp = opendir(dirPath);
+	if (!dp) 
+	{
+		WPRINT("unable to open directory.");
+		goto bail;
+	}
+
+	while ((de = readdir(dp)))
+	{
+		if (de->d_name[0] == '.') continue;
+		if (de->d_type != DT_REG)
+		{
+			if ((de->d_type != DT_UNKNOWN) && (de->d_type != DT_LNK)) continue;
+			snprintf(path, PATH_MAX, "%s/%s", dirPath, de->d_name);
+			if (stat(path, &st) || !S_ISREG(st.st_mode)) continue;
+		}
+		if (!filter(de->d_name)) continue;
+
+		len = strlen(de->d_name) + 1;
+		if ((n == DIR_LIST_BATCH) || (used + len > sizeof(batch)))
+		{
+			if (add(batch, used, n)) goto bail;
+			total += n;
+			if (progress) progress(total);
+			used = n = 0;
+		}
+		memcpy(batch + used, de->d_name, len);
+		used += len;
+		n++;
+	}
+
+	if (n)
+	{
+		if (add(batch, used, n)) goto bail;
+		total += n;
+	}
+	ret = total;
+
+ bail:
+	if (dp) closedir(dp);
+
+	// nothing is coming, commit publishes a complete scan.
+	if (ret < 0)
+	{
+		LOCK_LMUTEX();
+		done = 1;
+		UNLOCK_LMUTEX();
+		pthread_cond_broadcast(&listCond);
+	}
+
+	if ((ret >= 0) && progress) progress(total);
+	DBGLOG("%d entries listed.", total);
+	return ret;
+}
+
+/**
+ * Publish a complete listing at once, instead of reading directory.
+ *
+ * @param names
+ *        entry names, NUL separated, already filtered and sorted. 
+ *        Listing takes it over.
+ * @param bytes
+ *        size of names.
+ * @param n
+ *        number of entries.
+ * @return
+ *        number of entries, -1 on errors.
+ */
+int
+DirListLoad( char * names, int bytes, int n )
+{
+	int size;
+	int off;
+	int ii;
+	int ret = -1;
+
+	for (size = 1024; size < n * 2; size *= 2);
+
+	LOCK_LMUTEX();
+	offs = malloc((n? n : 1) * sizeof(int));
+	if (!offs) goto bail;
+
+	for (ii = 0, off = 0; (ii < n) && (off < bytes); ii++)
+	{
+		offs[ii] = off;
+		off += strlen(names + off) + 1;
+	}
+	arena = names;
+	names = NULL;
+	arenaUsed = arenaSize = bytes;
+	count = found = capacity = ii;
+	hashTab = hashBuild(offs, count, size);
+	if (!hashTab) 
+	{
+		count = found = 0;
+		goto bail;
+	}
+	hashSize = size;
+	ret = count;
+
+ bail:
+	done = 1;
+	UNLOCK_LMUTEX();
+	free(names);
+	pthread_cond_broadcast(&listCond);
+	return ret;
+}
+
+/**
+ * Get a copy of complete listing, in listing order.
+ *
+ * @param names
+ *        returned entry names, NUL separated, to be freed by caller.
+ * @param bytes
+ *        returned size of names.
+ * @return
+ *        number of entries, -1 on errors.
+ */
+int
+DirListExport( char ** names, int * bytes )
+{
+	char * p;
+	int len;
+	int ii;
+	int ret = -1;
+
+	LOCK_LMUTEX();
+	p = malloc(arenaUsed + 1);
+	if (!p) goto bail;
+
+	*names = p;
+	for (ii = 0; ii < count; ii++)
+	{
+		len = strlen(arena + offs[ii]) + 1;
+		memcpy(p, arena + offs[ii], len);
+		p += len;
+	}
+	*bytes = p - *names;
+	ret = count;
+
+ bail:
+	UNLOCK_LMUTEX();
+	return ret;
+}
+
+/**
+ * Prepare listing sorted by name, to be committed with DirListSortCommit().
+ * Called by the scanning thread after DirListScan().
+ *
+ * @return
+ *        0 if prepared, -1 if nothing to sort or out of memory.
+ */
+int
+DirListSortPrepare( void )
+{
+	int * order;
+	int ii;
+
+	// the scanning thread is the only writer, listing is stable here.
+	if (found < 2) return -1;
+
+	order = malloc(found * sizeof(int));
+	sortedOffs = malloc(found * sizeof(int));
+	if (!order || !sortedOffs) goto bail;
+
+	for (ii = 0; ii < found; ii++) order[ii] = ii;
+	qsort(order, found, sizeof(int), sortCompare);
+
+	for (ii = 0; ii < found; ii++) sortedOffs[ii] = offs[order[ii]];
+	sortedHash = hashBuild(sortedOffs, found, hashSize);
+	if (!sortedHash) goto bail;
+
+	free(order);
+	return 0;
+
+ bail:
+	free(order);
+	free(sortedOffs);
+	sortedOffs = NULL;
+	return -1;
+}
+
+/**
+ * Switch to the sorted listing prepared, if any, and publish it.
+ */
+void
+DirListSortCommit( void )
+{
+	LOCK_LMUTEX();
+	if (sortedOffs && sortedHash)
+	{
+		free(offs);
+		free(hashTab);
+		offs = sortedOffs;
+		hashTab = sortedHash;
+		capacity = found;
+		sortedOffs = sortedHash = NULL;
+	}
+	count = found;
+	done = 1;
+	UNLOCK_LMUTEX();
+	pthread_cond_broadcast(&listCond);
+}
+
+/**
+ * Get number of entries published.
+ */
+int
+DirListCount( void )
+{
+	int n;
+
+	LOCK_LMUTEX();
+	n = count;
+	UNLOCK_LMUTEX();
+	return n;
+}
+
+/**
+ * Locate a file in listing.
+ *
+ * @param path
+ *        file path, or entry name.
+ * @return
+ *        entry index, -1 if not listed.
+ */
+int
+DirListFind( const char * path )
+{
+	const char * name;
+	unsigned int h;
+	int idx = -1;
+	int e;
+
+	name = strrchr(path, '/');
+	if (name)
+	{
+		// must be in our directory.
+		if ((name - path != strlen(dirPath)) || strncmp(path, dirPath, name - path))
+			return -1;
+		name++;
+	}
+	else name = path;
+
+	h = NmsHashString(name);
+	LOCK_LMUTEX();
+	if (hashSize)
+	{
+		while ((e = hashTab[h & (hashSize - 1)]))
+		{
+			// entries not published yet have no index.
+			if ((e <= count) && !strcmp(arena + offs[e - 1], name))
+			{
+				idx = e - 1;
+				break;
+			}
+			h++;
+		}
+	}
+	UNLOCK_LMUTEX();
+	return idx;
+}
+
+/**
+ * Get path of a listed file.
+ *
+ * @param idx
+ *        entry index.
+ * @param buf
+ *        path buffer.
+ * @param size
+ *        buffer size.
+ * @param wait
+ *        nonzero to wait for the entry if it is not published yet.
+ * @return
+ *        buf if entry exists, otherwise NULL.
+ */
+char *
+DirListGet( int idx, char * buf, int size, int wait )
+{
+	char * ret = NULL;
+
+	LOCK_LMUTEX();
+	while (wait && (idx >= count) && !done && !aborted)
+		pthread_cond_wait(&listCond, &listMutex);
+
+	if ((idx >= 0) && (idx < count))
+	{
+		snprintf(buf, size, "%s/%s", dirPath, arena + offs[idx]);
+		ret = buf;
+	}
+	UNLOCK_LMUTEX();
+	return ret;
+}
@@ -0,0 +1,52 @@
+#ifndef NMS_SERVER_DIR_LIST__H
+#define NMS_SERVER_DIR_LIST__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms streaming directory listing header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 3) Sort preparation returns status. ------------------- 2026-10-19
+ * 2) Load and export complete listings. ----------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define DIR_LIST_BATCH     256   // entries added at a time.
+
+typedef int  (*dir_filter_t)(const char *);
+typedef void (*dir_progress_t)(int);
+
+void  DirListReset(const char *);
+void  DirListAbort(void);
+int   DirListScan(dir_filter_t, dir_progress_t);
+int   DirListLoad(char *, int, int);
+int   DirListExport(char **, int *);
+int   DirListSortPrepare(void);
+void  DirListSortCommit(void);
+int   DirListCount(void);
+int   DirListFind(const char *);
+char *DirListGet(int, char *, int, int);
+
+#endif /* NMS_SERVER_DIR_LIST__H */
@@ -0,0 +1,619 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms directory tree walk.
+ *
+ * Plays a whole tree as one list of files: directories are walked depth 
+ * first, subdirectories and files of each in name order. The walk uses
+ * openat() and getdents64() on directory descriptors, and keeps one small
+ * record per directory only: its name, parent, number of matching files
+ * and index of its first file in the tree. File names are not kept, the
+ * directory holding a wanted index is read again on demand into one of a
+ * few windows. Memory thus grows with the number of directories, never 
+ * with the number of files.
+ *
+ * Records are published as directories are walked, indexes handed out 
+ * never change since files of later directories always come after.
+ *
+ * Each record also keeps a hash over its file names. A directory read 
+ * again into a window must hash the same, or its files are not handed out
+ * at all: their indexes no longer tell which file they were given for. A
+ * window is read again once the directory mtime changes.
+ *
+ * REVISION:
+ * 
+ * 2) Refuse files of directories changed since walked. --- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-dir-tree.h"
+#include "nms-hash.h"
+
+#define DENTS_BUF      8192
+#define NO_REC         (-1)
+
+struct linux_dirent64
+{
+	unsigned long long d_ino;
+	long long          d_off;
+	unsigned short     d_reclen;
+	unsigned char      d_type;
+	char               d_name[];
+};
+
+typedef struct
+{
+	int           parent;
+	int           name;     // offset in dirNames.
+	int           first;    // tree index of first file.
+	int           count;    // matching files.
+	unsigned int  sum;      // hash of matching file names, in any order.
+} dir_rec_t;
+
+typedef struct
+{
+	int           rec;      // directory held, NO_REC if none.
+	char *        names;    // sorted file names.
+	int *         offs;
+	int           count;
+	int           stamp;
+	time_t        mtime;    // of directory when read.
+} dir_window_t;
+
+static pthread_mutex_t    treeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     treeCond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t    windowMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static char               rootPath[PATH_MAX];
+static dir_filter_t       fileFilter;
+static dir_rec_t *        recs;
+static int                recCount;
+static int                recCap;
+static char *             dirNames;
+static int                namesUsed;
+static int                namesSize;
+static int                total;      // files published.
+static int                done;
+static int                aborted;
+
+static dir_window_t       windows[DIR_TREE_WINDOWS];
+static int                windowClock;
+
+#define LOCK_TMUTEX()   pthread_mutex_lock(&treeMutex)
+#define UNLOCK_TMUTEX() pthread_mutex_unlock(&treeMutex)
+
+static pthread_mutex_t    sortMutex = PTHREAD_MUTEX_INITIALIZER;
+static char *             sortBase;
+
+static int nameCompare( const void * a, const void * b )
+{
+	return strcmp(sortBase + *(const int *)a, sortBase + *(const int *)b);
+}
+
+static int isDot( const char * name )
+{
+	// hidden entries, "." and ".." included.
+	return name[0] == '.';
+}
+
+/**
+ * Read a directory, calling back for each subdirectory and matching file.
+ * Entry type is asked for only if the file system does not tell.
+ */
+static int readDir( int fd, void (*onEntry)(const char *, int, void *), void * ctx )
+{
+	char buf[DENTS_BUF];
+	struct linux_dirent64 * de;
+	struct stat st;
+	int len;
+	int off;
+	int isdir;
+
+	while ((len = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0)
+	{
+		if (aborted) return -1;
+		for (off = 0; off < len; off += de->d_reclen)
+		{
+			de = (struct linux_dirent64 *)(buf + off);
+			if (isDot(de->d_name)) continue;
+
+			switch (de->d_type)
+			{
+			case DT_DIR: isdir = 1; break;
+			case DT_REG: isdir = 0; break;
+			case DT_UNKNOWN:
+				if (fstatat(fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW)) continue;
+				if (S_ISDIR(st.st_mode)) isdir = 1;
+				else if (S_ISREG(st.st_mode)) isdir = 0;
+				else continue;
+				break;
+			default: 
+				// links are not followed, trees may loop.
+				continue;
+			}
+			if (!isdir && !fileFilter(de->d_name)) continue;
+			onEntry(de->d_name, isdir, ctx);
+		}
+	}
+	return len;
+}
+
+typedef struct
+{
+	char *  names;
+	int     used;
+	int     size;
+	int *   offs;
+	int     n;
+	int     cap;
+	int     files;
+	unsigned int sum;
+	int     wantDirs;
+} entry_set_t;
+
+static void collect( const char * name, int isdir, void * ctx )
+{
+	entry_set_t * es = (entry_set_t *)ctx;
+	int len = strlen(name) + 1;
+	void * p;
+
+	if (!isdir)
+	{
+		es->files++;
+		es->sum += NmsHashString(name);
+	}
+	if (isdir != es->wantDirs) return;
+
+	if (es->used + len > es->size)
+	{
+		p = realloc(es->names, (es->used + len) * 2);
+		if (!p) return;
+		es->names = p;
+		es->size = (es->used + len) * 2;
+	}
+	if (es->n == es->cap)
+	{
+		p = realloc(es->offs, (es->cap + 64) * sizeof(int));
+		if (!p) return;
+		es->offs = p;
+		es->cap += 64;
+	}
+	memcpy(es->names + es->used, name, len);
+	es->offs[es->n++] = es->used;
+	es->used += len;
+}
+
+static void sortSet( entry_set_t * es )
+{
+	// walk and windows may sort at the same time.
+	pthread_mutex_lock(&sortMutex);
+	sortBase = es->names;
+	qsort(es->offs, es->n, sizeof(int), nameCompare);
+	pthread_mutex_unlock(&sortMutex);
+}
+
+static int addRecord( int parent, const char * name )
+{
+	int len = strlen(name) + 1;
+	void * p;
+	int rec = NO_REC;
+
+	LOCK_TMUTEX();
+	if (recCount == recCap)
+	{
+		p = realloc(recs, (recCap + 256) * sizeof(dir_rec_t));
+		if (!p) goto bail;
+		recs = p;
+		recCap += 256;
+	}
+	if (namesUsed + len > namesSize)
+	{
+		p = realloc(dirNames, (namesUsed + len) * 2);
+		if (!p) goto bail;
+		dirNames = p;
+		namesSize = (namesUsed + len) * 2;
+	}
+	memcpy(dirNames + namesUsed, name, len);
+	rec = recCount++;
+	recs[rec].parent = parent;
+	recs[rec].name = namesUsed;
+	recs[rec].first = total;
+	recs[rec].count = 0;
+	recs[rec].sum = 0;
+	namesUsed += len;
+
+ bail:
+	UNLOCK_TMUTEX();
+	return rec;
+}
+
+static int walk( int fd, int rec, int depth, dir_progress_t progress )
+{
+	entry_set_t es;
+	int ii;
+	int sub;
+	int subfd;
+	int n;
+
+	memset(&es, 0, sizeof(es));
+	es.wantDirs = 1;
+	if (readDir(fd, collect, &es) < 0) goto bail;
+
+	// files of this directory come before those of its subdirectories.
+	LOCK_TMUTEX();
+	recs[rec].first = total;
+	recs[rec].count = es.files;
+	recs[rec].sum = es.sum;
+	total += es.files;
+	n = total;
+	UNLOCK_TMUTEX();
+	if (es.files)
+	{
+		pthread_cond_broadcast(&treeCond);
+		if (progress) progress(n);
+	}
+
+	if (depth >= DIR_TREE_DEPTH) goto bail;
+
+	sortSet(&es);
+	for (ii = 0; (ii < es.n) && !aborted; ii++)
+	{
+		subfd = openat(fd, es.names + es.offs[ii], O_RDONLY | O_DIRECTORY);
+		if (subfd < 0) continue;
+
+		sub = addRecord(rec, es.names + es.offs[ii]);
+		if (sub != NO_REC) walk(subfd, sub, depth + 1, progress);
+		close(subfd);
+	}
+
+ bail:
+	free(es.names);
+	free(es.offs);
+	return aborted? -1 : 0;
+}
+
+static int recOf( int idx )
+{
+	int lo = 0;
+	int hi = recCount - 1;
+	int mid;
+
+	// last record starting at or before idx, empty ones come first.
+	while (lo < hi)
+	{
+		mid = (lo + hi + 1) / 2;
+		if (recs[mid].first <= idx) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+static char * recPath( int rec, char * buf, int size )
+{
+	int chain[DIR_TREE_DEPTH + 1];
+	int depth = 0;
+	int len;
+
+	// records above root, root itself has no name of its own.
+	for (; rec > 0 && depth <= DIR_TREE_DEPTH; rec = recs[rec].parent) 
+		chain[depth++] = rec;
+
+	len = snprintf(buf, size, "%s", rootPath);
+	while (depth-- && (len < size))
+		len += snprintf(buf + len, size - len, "/%s", dirNames + recs[chain[depth]].name);
+	return buf;
+}
+
+static void windowFree( dir_window_t * w )
+{
+	free(w->names);
+	free(w->offs);
+	memset(w, 0, sizeof(dir_window_t));
+	w->rec = NO_REC;
+}
+
+// get window holding files of a directory as walked, caller holds 
+// windowMutex. NULL if the directory changed since.
+static dir_window_t * window( int rec )
+{
+	char path[PATH_MAX];
+	struct stat st;
+	dir_window_t * w;
+	entry_set_t es;
+	unsigned int sum;
+	int files;
+	int fd;
+	int ii;
+
+	LOCK_TMUTEX();
+	recPath(rec, path, PATH_MAX);
+	files = recs[rec].count;
+	sum = recs[rec].sum;
+	UNLOCK_TMUTEX();
+
+	fd = open(path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return NULL;
+	if (fstat(fd, &st)) st.st_mtime = 0;
+
+	w = &windows[0];
+	for (ii = 0; ii < DIR_TREE_WINDOWS; ii++)
+	{
+		if (windows[ii].rec == rec) 
+		{
+			w = &windows[ii];
+			if (w->mtime == st.st_mtime)
+			{
+				close(fd);
+				w->stamp = ++windowClock;
+				return w;
+			}
+			break;
+		}
+		if (windows[ii].stamp < w->stamp) w = &windows[ii];
+	}
+	windowFree(w);
+
+	memset(&es, 0, sizeof(es));
+	es.wantDirs = 0;
+	readDir(fd, collect, &es);
+	close(fd);
+	if ((es.files != files) || (es.sum != sum))
+	{
+		DBGLOG("%s changed since walked.", path);
+		free(es.names);
+		free(es.offs);
+		return NULL;
+	}
+	sortSet(&es);
+
+	w->rec = rec;
+	w->names = es.names;
+	w->offs = es.offs;
+	w->count = es.n;
+	w->stamp = ++windowClock;
+	w->mtime = st.st_mtime;
+	return w;
+}
+
+/**
+ * Drop current tree and get ready to walk another.
+ *
+ * @param root
+ *        root directory path.
+ */
+void
+TreeReset( const char * root )
+{
+	int ii;
+
+	LOCK_TMUTEX();
+	free(recs);
+	free(dirNames);
+	recs = NULL;
+	dirNames = NULL;
+	recCount = recCap = 0;
+	namesUsed = namesSize = 0;
+	total = 0;
+	done = aborted = 0;
+	strncpy(rootPath, root, PATH_MAX - 1);
+	rootPath[PATH_MAX - 1] = 0;
+	for (ii = strlen(rootPath) - 1; (ii > 0) && (rootPath[ii] == '/'); ii--) 
+		rootPath[ii] = 0;
+	UNLOCK_TMUTEX();
+
+	pthread_mutex_lock(&windowMutex);
+	for (ii = 0; ii < DIR_TREE_WINDOWS; ii++) windowFree(&windows[ii]);
+	pthread_mutex_unlock(&windowMutex);
+}
+
+/**
+ * Stop a walk in progress, and release anyone waiting for entries.
+ */
+void
+TreeAbort( void )
+{
+	LOCK_TMUTEX();
+	aborted = 1;
+	UNLOCK_TMUTEX();
+	pthread_cond_broadcast(&treeCond);
+}
+
+/**
+ * Walk tree, publishing directories as they are read.
+ *
+ * @param filter
+ *        file name filter, nonzero to take the file.
+ * @param progress
+ *        called with number of files after each directory holding any,
+ *        may be NULL.
+ * @return
+ *        number of files, -1 if walk was aborted.
+ */
+int
+TreeScan( dir_filter_t filter, dir_progress_t progress )
+{
+	int fd;
+	int ret = -1;
+
+	fileFilter = filter;
+	fd = open(rootPath, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+	{
+		WPRINT("unable to open directory.");
+		goto bail;
+	}
+
+	if ((addRecord(NO_REC, "") != NO_REC) && !walk(fd, 0, 0, progress)) ret = total;
+	close(fd);
+
+ bail:
+	LOCK_TMUTEX();
+	done = 1;
+	UNLOCK_TMUTEX();
+	pthread_cond_broadcast(&treeCond);
+
+	DBGLOG("%d files in %d directories.", total, recCount);
+	return ret;
+}
+
+/**
+ * Get number of files published so far.
+ */
+int
+TreeCount( void )
+{
+	int n;
+
+	LOCK_TMUTEX();
+	n = total;
+	UNLOCK_TMUTEX();
+	return n;
+}
+
+/**
+ * Locate a file in tree.
+ *
+ * @param path
+ *        file path.
+ * @return
+ *        tree index, -1 if not in tree, not walked yet, or its directory
+ *        changed since.
+ */
+int
+TreeFind( const char * path )
+{
+	char name[NAME_MAX + 1];
+	const char * s;
+	const char * e;
+	dir_window_t * w;
+	int rec = 0;
+	int first;
+	int len;
+	int ii;
+	int idx = -1;
+
+	len = strlen(rootPath);
+	if (strncmp(path, rootPath, len) || (path[len] != '/')) return -1;
+
+	LOCK_TMUTEX();
+	if (!recCount) 
+	{
+		UNLOCK_TMUTEX();
+		return -1;
+	}
+	// follow directory components down the records.
+	for (s = path + len + 1; (e = strchr(s, '/')); s = e + 1)
+	{
+		if ((e - s) > NAME_MAX) break;
+		memcpy(name, s, e - s);
+		name[e - s] = 0;
+		for (ii = rec + 1; ii < recCount; ii++)
+		{
+			if ((recs[ii].parent == rec) && !strcmp(dirNames + recs[ii].name, name)) break;
+		}
+		if (ii == recCount) break;
+		rec = ii;
+	}
+	first = recs[rec].first;
+	UNLOCK_TMUTEX();
+	if (e) return -1;
+
+	pthread_mutex_lock(&windowMutex);
+	w = window(rec);
+	for (ii = 0; w && (ii < w->count); ii++)
+	{
+		if (!strcmp(w->names + w->offs[ii], s)) 
+		{
+			idx = first + ii;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&windowMutex);
+	return idx;
+}
+
+/**
+ * Get path of a file in tree.
+ *
+ * @param idx
+ *        tree index.
+ * @param buf
+ *        path buffer.
+ * @param size
+ *        buffer size.
+ * @param wait
+ *        nonzero to wait for the file if it is not walked yet.
+ * @return
+ *        buf if file exists, otherwise NULL, also if its directory gained
+ *        or lost files since it was walked.
+ */
+char *
+TreeGet( int idx, char * buf, int size, int wait )
+{
+	char path[PATH_MAX];
+	dir_window_t * w;
+	char * ret = NULL;
+	int rec;
+	int local;
+
+	if (idx < 0) return NULL;
+
+	LOCK_TMUTEX();
+	while (wait && (idx >= total) && !done && !aborted)
+		pthread_cond_wait(&treeCond, &treeMutex);
+	if (idx >= total) 
+	{
+		UNLOCK_TMUTEX();
+		return NULL;
+	}
+	rec = recOf(idx);
+	local = idx - recs[rec].first;
+	recPath(rec, path, PATH_MAX);
+	UNLOCK_TMUTEX();
+
+	pthread_mutex_lock(&windowMutex);
+	w = window(rec);
+	if (w && (local < w->count))
+	{
+		snprintf(buf, size, "%s/%s", path, w->names + w->offs[local]);
+		ret = buf;
+	}
+	pthread_mutex_unlock(&windowMutex);
+	return ret;
+}
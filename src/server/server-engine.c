@@ -0,0 +1,238 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms engine worker threads.
+ *
+ * Playback and recording loops run as jobs on long lived threads, one per
+ * role, instead of a thread created and joined per track or recording. 
+ * Each thread is created the first time its role gets a job and then 
+ * waits for the next one, so it keeps its thread id, scheduling policy and
+ * CPU affinity across tracks. A role takes one job at a time, submitting 
+ * and waiting stand in for pthread_create() and pthread_join(). Jobs must 
+ * return rather than call pthread_exit().
+ *
+ * REVISION:
+ * 
+ * 2) Apply role scheduling on thread start. ------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "server-engine.h"
+#include "server-sched.h"
+
+typedef enum
+	{
+		EW_IDLE,        // waiting for a job.
+		EW_QUEUED,      // job handed over, not picked up yet.
+		EW_RUNNING      // job running.
+	} ENGINE_WORKER_STATE;
+
+typedef struct
+{
+	pthread_t            thread;
+	int                  started;
+	pid_t                tid;
+	ENGINE_WORKER_STATE  state;
+	engine_job_t         job;
+	void *               arg;
+	pthread_cond_t       jobCond;   // job submitted.
+	pthread_cond_t       doneCond;  // job finished.
+} engine_worker_t;
+
+static pthread_mutex_t    engineMutex = PTHREAD_MUTEX_INITIALIZER;
+static engine_worker_t    workers[ENGINE_ROLES];
+
+// scheduling of each engine role.
+static const SCHED_ROLE   schedRoles[ENGINE_ROLES] =
+{
+	SR_PLAYBACK,
+	SR_NEXT_FILE,
+	SR_DIR_INIT,
+	SR_REC_AUDIO,
+	SR_REC_VIDEO,
+	SR_REC_MUX,
+	SR_WRITER,
+	SR_REC_SPACE,
+	SR_REC_SEGMENT,
+	SR_REC_TIMER
+};
+
+#define LOCK_ENGINEMUTEX()   pthread_mutex_lock(&engineMutex)
+#define UNLOCK_ENGINEMUTEX() pthread_mutex_unlock(&engineMutex)
+
+static void * engineLoop( void * arg )
+{
+	engine_worker_t * w = arg;
+	engine_job_t job;
+
+	SchedApply(schedRoles[w - workers]);
+
+	LOCK_ENGINEMUTEX();
+	w->tid = syscall(SYS_gettid);
+	UNLOCK_ENGINEMUTEX();
+
+	while (1)
+	{
+		LOCK_ENGINEMUTEX();
+		while (w->state != EW_QUEUED)
+			pthread_cond_wait(&w->jobCond, &engineMutex);
+		w->state = EW_RUNNING;
+		job = w->job;
+		arg = w->arg;
+		UNLOCK_ENGINEMUTEX();
+
+		job(arg);
+
+		LOCK_ENGINEMUTEX();
+		w->state = EW_IDLE;
+		w->job = NULL;
+		UNLOCK_ENGINEMUTEX();
+		pthread_cond_broadcast(&w->doneCond);
+	}
+	return NULL;
+}
+
+static int startWorker( engine_worker_t * w )
+{
+	int status;
+	
+	pthread_cond_init(&w->jobCond, NULL);
+	pthread_cond_init(&w->doneCond, NULL);
+
+	status = pthread_create(&w->thread, NULL, engineLoop, w);
+	if (status)
+	{
+		WPRINT("Thread was not created!");
+		switch (status)
+		{
+		case EAGAIN:
+			EPRINT("The system lacked the necessary resources to create "
+				   "another thread, or the system-imposed limit on the total "
+				   "number of threads in a process {PTHREAD_THREADS_MAX} " 
+				   "would be exceeded.");
+			break;
+		case EINVAL:
+			EPRINT("The value specified by attr is invalid.");
+			break;
+		case EPERM:
+			EPRINT("The caller does not have appropriate permission to "
+				   "set  the  required "
+				   "scheduling  parameters  or scheduling policy.");
+			break;
+		default:
+			EPRINT("Unknown error!");
+			break;
+		}
+		pthread_cond_destroy(&w->jobCond);
+		pthread_cond_destroy(&w->doneCond);
+		return status;
+	}
+	w->started = 1;
+	return 0;
+}
+
+/**
+ * Run a job on the thread of given role.
+ *
+ * @param role
+ *        engine thread role.
+ * @param job
+ *        job function, its return value is ignored.
+ * @param arg
+ *        job argument.
+ * @return
+ *        0 if job was handed over, nonzero if thread could not be 
+ *        created or role is still busy with a previous job.
+ */
+int
+EngineSubmit( ENGINE_ROLE role, engine_job_t job, void * arg )
+{
+	engine_worker_t * w = &workers[role];
+	int status = 0;
+
+	LOCK_ENGINEMUTEX();
+	if (w->state != EW_IDLE)
+	{
+		WPRINT("engine role %d is busy.", role);
+		status = -1;
+		goto bail;
+	}
+	if (!w->started)
+	{
+		status = startWorker(w);
+		if (status) goto bail;
+	}
+	w->job = job;
+	w->arg = arg;
+	w->state = EW_QUEUED;
+	pthread_cond_signal(&w->jobCond);
+
+ bail:
+	UNLOCK_ENGINEMUTEX();
+	return status;
+}
+
+/**
+ * Wait till the job of given role has finished, returns at once if the
+ * role has no job. Must not be called from the job itself.
+ *
+ * @param role
+ *        engine thread role.
+ */
+void
+EngineWait( ENGINE_ROLE role )
+{
+	engine_worker_t * w = &workers[role];
+
+	LOCK_ENGINEMUTEX();
+	while (w->state != EW_IDLE)
+		pthread_cond_wait(&w->doneCond, &engineMutex);
+	UNLOCK_ENGINEMUTEX();
+}
+
+/**
+ * @param role
+ *        engine thread role.
+ * @return
+ *        kernel thread id of the role, 0 if not started yet.
+ */
+pid_t
+EngineGetTid( ENGINE_ROLE role )
+{
+	pid_t tid;
+
+	LOCK_ENGINEMUTEX();
+	tid = workers[role].tid;
+	UNLOCK_ENGINEMUTEX();
+	return tid;
+}
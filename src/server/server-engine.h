@@ -0,0 +1,59 @@
+#ifndef NMS_SERVER_ENGINE__H
+#define NMS_SERVER_ENGINE__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms engine worker threads header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 2) Added recording timer role. ------------------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <sys/types.h>
+
+/// engine thread roles, one persistent thread each.
+typedef enum
+	{
+		ENGINE_AV,          // playback a/v loop.
+		ENGINE_NEXT_FILE,   // directory/playlist next file loop.
+		ENGINE_DIR_INIT,    // directory listing.
+		ENGINE_REC_AUDIO,   // recording audio loop.
+		ENGINE_REC_VIDEO,   // recording video loop.
+		ENGINE_REC_MUX,     // recording mux loop.
+		ENGINE_REC_WRITER,  // recording write-behind.
+		ENGINE_REC_SPACE,   // recording free space monitor.
+		ENGINE_REC_SEGMENT, // recording next segment preparation.
+		ENGINE_REC_TIMER,   // recording timers.
+		ENGINE_ROLES
+	} ENGINE_ROLE;
+
+typedef void * (*engine_job_t)(void *);
+
+int   EngineSubmit(ENGINE_ROLE, engine_job_t, void *);
+void  EngineWait(ENGINE_ROLE);
+pid_t EngineGetTid(ENGINE_ROLE);
+
+#endif /* NMS_SERVER_ENGINE__H */
@@ -24,6 +24,18 @@
  *
  * REVISION:
  * 
+ * 17) Recorder commands under recorder control. ------- 2026-10-19
+ * 16) Added recording timer commands. ----------------- 2026-10-19
+ * 15) Added pre-roll commands. ------------------------ 2026-10-19
+ * 14) Added recording statistics command. ------------- 2026-10-19
+ * 13) Added recording segment command. ---------------- 2026-10-19
+ * 12) Added recording free space command. ------------- 2026-10-19
+ * 11) Added recording write-behind commands. ----------- 2026-10-19
+ * 10) Added thread scheduling diagnostics command. ---- 2026-10-19
+ * 9) Added stop latency statistics command. ------------ 2026-10-19
+ * 8) Added unplayable file cache statistics command. ----- 2026-10-19
+ * 7) Added batch media probe command. -------------------- 2026-10-19
+ * 6) Added media info cache statistics command. --------- 2026-10-19
  * 5) Added in background preference support, start of
  *    service does not stop other by default. ------------- 2007-08-07 MG
  * 4) Remove table for dbg cmd names. Handle PLAY retval -- 2007-05-24 nerochiaro
@@ -45,6 +57,9 @@
 #include "plugin-internals.h"
 #include "video-control.h"
 #include "server-monitor-internal.h"
+#include "server-probe.h"
+#include "server-sched.h"
+#include "server-rec-timer.h"
 
 const char version[] = "1.0.2";
 static int just_recorded = FALSE;
@@ -89,6 +104,11 @@ static int StartPlay ( void * data, int dataLen )
 		  break;
 
 	  case NPT_PLAYLIST: /* playlist.    */
+		  DBGLOG("Start to play playlist");
+		  ret = SrvPlayList(p+sizeof(int));
+		  just_recorded = FALSE;
+		  break;
+
 	  case NPT_DB:       /* Neuros DB.   */
 	  case NPT_OTHER:     /* other.       */
 	  default: break;
@@ -99,12 +119,16 @@ static int StartPlay ( void * data, int dataLen )
 static NMS_SRV_RECORD_ERROR StartRecord ( void * data, int dataLen, NMS_SRV_ERROR_DETAIL *detail )
 {
 	rec_ctrl_t *params = (rec_ctrl_t*) data;
+	NMS_SRV_RECORD_ERROR ret;
 
 	memset(record_file, 0, sizeof(record_file));
 	strncpy(record_file, data + sizeof(rec_ctrl_t), dataLen);
 
 	just_recorded = TRUE;
-	return SrvRecord(params, data + sizeof(rec_ctrl_t), detail);
+	SrvLockRecorder();
+	ret = SrvRecord(params, data + sizeof(rec_ctrl_t), detail);
+	SrvUnlockRecorder();
+	return ret;
 }
 
 /**
@@ -121,6 +145,7 @@ SrvRxCmd( void * pkt )
 {
 	int ret = 0;
 	int acked = 0;
+	int handedOff = 0; // connection now owned elsewhere.
 
 	pkt_node_t * p = (pkt_node_t *)pkt;
 
@@ -149,6 +174,7 @@ SrvRxCmd( void * pkt )
 		DBGLOG("CMD_SET_OUTPUT_MODE.");
 	  	{
 			OutputSetMode(*(int*)p->data);
+			SrvLockRecorder();
 			if (SrvIsMonitorActive())
 			{
 				SrvStartMonitorInternal();
@@ -160,6 +186,7 @@ SrvRxCmd( void * pkt )
 			{
 				OutputActivateMode(0);
 			}
+			SrvUnlockRecorder();
 	  	}
 	  	break;
 
@@ -444,6 +471,66 @@ SrvRxCmd( void * pkt )
 		}
 		break;		
 
+	case CMD_GET_MEDIA_CACHE_STATS:
+		DBGLOG("CMD_GET_MEDIA_CACHE_STATS.");
+		{
+			media_cache_stats_t stats;
+
+			SrvGetMediaCacheStats(&stats);
+			CoolCmdSendPacket(p->fd, CMD_GET_MEDIA_CACHE_STATS|NMS_CMD_ACK,
+						  (void *)(&stats), sizeof(media_cache_stats_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_BAD_FILE_STATS:
+		DBGLOG("CMD_GET_BAD_FILE_STATS.");
+		{
+			bad_file_stats_t stats;
+
+			SrvGetBadFileStats(&stats);
+			CoolCmdSendPacket(p->fd, CMD_GET_BAD_FILE_STATS|NMS_CMD_ACK,
+						  (void *)(&stats), sizeof(bad_file_stats_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_STOP_LATENCY_STATS:
+		DBGLOG("CMD_GET_STOP_LATENCY_STATS.");
+		{
+			stop_latency_stats_t stats;
+
+			SrvGetStopLatencyStats(&stats);
+			CoolCmdSendPacket(p->fd, CMD_GET_STOP_LATENCY_STATS|NMS_CMD_ACK,
+						  (void *)(&stats), sizeof(stop_latency_stats_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_SCHED_INFO:
+		DBGLOG("CMD_GET_SCHED_INFO.");
+		{
+			sched_role_info_t info[SR_ROLES];
+			int cnt;
+
+			cnt = SchedGetInfo(info, SR_ROLES);
+			CoolCmdSendPacket(p->fd, CMD_GET_SCHED_INFO|NMS_CMD_ACK,
+						  (void *)info, cnt * sizeof(sched_role_info_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_MEDIA_INFO_BATCH:
+		DBGLOG("CMD_MEDIA_INFO_BATCH.");
+		// results are streamed back by probe workers, an empty batch 
+		// is simply ended by the ack below.
+		if (!ProbeBatchStart(p->fd, (char *)p->data, p->hdr.dataLen))
+		{
+			acked = 1;
+			handedOff = 1;
+		}
+		break;
+
 		/* start of encoder interface. */
 	case CMD_RECORD:
 		DBGLOG("CMD_RECORD.");
@@ -459,12 +546,16 @@ SrvRxCmd( void * pkt )
 
 	case CMD_PAUSE_UNPAUSE_RECORD:
 		DBGLOG("CMD_PAUSE_UNPAUSE_RECORD.");
+		SrvLockRecorder();
 		SrvPauseRecord(*(int*)p->data);
+		SrvUnlockRecorder();
 		break;
 		
 	case CMD_STOP_RECORD:
 		DBGLOG("CMD_STOP_RECORD.");
+		SrvLockRecorder();
 		SrvStopRecord();
+		SrvUnlockRecorder();
 		break;
 		
 	case CMD_GET_GAIN:
@@ -490,6 +581,110 @@ SrvRxCmd( void * pkt )
 		}
 		break;
 		
+	case CMD_GET_REC_WRITER_STATS:
+		DBGLOG("CMD_GET_REC_WRITER_STATS.");
+		{
+			rec_writer_stats_t stats;
+
+			SrvGetRecordWriterStats(&stats);
+			CoolCmdSendPacket(p->fd, CMD_GET_REC_WRITER_STATS|NMS_CMD_ACK,
+						  (void *)(&stats), sizeof(rec_writer_stats_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_RECORD_SPACE:
+		DBGLOG("CMD_GET_RECORD_SPACE.");
+		{
+			rec_space_info_t info;
+
+			SrvGetRecordSpace(&info);
+			CoolCmdSendPacket(p->fd, CMD_GET_RECORD_SPACE|NMS_CMD_ACK,
+						  (void *)(&info), sizeof(rec_space_info_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_RECORD_SEGMENTS:
+		DBGLOG("CMD_GET_RECORD_SEGMENTS.");
+		{
+			rec_segment_info_t info;
+
+			SrvGetRecordSegments(&info);
+			CoolCmdSendPacket(p->fd, CMD_GET_RECORD_SEGMENTS|NMS_CMD_ACK,
+						  (void *)(&info), sizeof(rec_segment_info_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_GET_RECORD_STATS:
+		DBGLOG("CMD_GET_RECORD_STATS.");
+		{
+			rec_stats_t stats;
+
+			SrvGetRecordStats(&stats);
+			CoolCmdSendPacket(p->fd, CMD_GET_RECORD_STATS|NMS_CMD_ACK,
+						  (void *)(&stats), sizeof(rec_stats_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_SET_PREROLL:
+		DBGLOG("CMD_SET_PREROLL.");
+		if (p->hdr.dataLen >= sizeof(int))
+			SrvSetPreroll(*(int *)p->data);
+		break;
+
+	case CMD_GET_PREROLL:
+		DBGLOG("CMD_GET_PREROLL.");
+		{
+			rec_preroll_info_t info;
+
+			SrvGetPreroll(&info);
+			CoolCmdSendPacket(p->fd, CMD_GET_PREROLL|NMS_CMD_ACK,
+						  (void *)(&info), sizeof(rec_preroll_info_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_ADD_REC_TIMER:
+		DBGLOG("CMD_ADD_REC_TIMER.");
+		{
+			int id = -1;
+
+			if (p->hdr.dataLen >= sizeof(rec_timer_t))
+				id = TimerAdd((rec_timer_t *)p->data);
+			CoolCmdSendPacket(p->fd, CMD_ADD_REC_TIMER|NMS_CMD_ACK,
+						  (void *)(&id), sizeof(int));
+			acked = 1;
+		}
+		break;
+
+	case CMD_REMOVE_REC_TIMER:
+		DBGLOG("CMD_REMOVE_REC_TIMER.");
+		if (p->hdr.dataLen >= sizeof(int))
+			TimerRemove(*(int *)p->data);
+		break;
+
+	case CMD_GET_REC_TIMERS:
+		DBGLOG("CMD_GET_REC_TIMERS.");
+		{
+			rec_timer_t timers[REC_TIMER_SLOTS];
+			int cnt;
+
+			cnt = TimerGetAll(timers, REC_TIMER_SLOTS);
+			CoolCmdSendPacket(p->fd, CMD_GET_REC_TIMERS|NMS_CMD_ACK,
+						  (void *)timers, cnt * sizeof(rec_timer_t));
+			acked = 1;
+		}
+		break;
+
+	case CMD_SET_REC_WRITER_BUDGET:
+		DBGLOG("CMD_SET_REC_WRITER_BUDGET.");
+		if (p->hdr.dataLen >= sizeof(unsigned int))
+			SrvSetRecordWriterBudget(*(unsigned int *)p->data);
+		break;
+
 	case CMD_GET_RECORD_TIME:
 		DBGLOG("CMD_GET_RECORD_TIME.");
 		{
@@ -539,7 +734,9 @@ SrvRxCmd( void * pkt )
 		{
 			int startmonitor;
 			int pid = (*(int*)p->data);
+			SrvLockRecorder();
 			startmonitor = SrvStartMonitor(pid);
+			SrvUnlockRecorder();
 			CoolCmdSendPacket(p->fd, CMD_START_MONITOR|NMS_CMD_ACK, 
 						  (void*)&startmonitor, sizeof(int));
 			acked = 1;
@@ -551,7 +748,9 @@ SrvRxCmd( void * pkt )
 		DBGLOG("CMD_STOP_MONITOR.");
 
 		int pid = (*(int*)p->data);
+		SrvLockRecorder();
 		SrvStopMonitor(pid);
+		SrvUnlockRecorder();
 		break;
 
 	case CMD_IS_MONITOR_ENABLED:
@@ -635,7 +834,7 @@ SrvRxCmd( void * pkt )
 		CoolCmdSendPacket(p->fd, p->hdr.cmd|NMS_CMD_ACK, NULL, 0);
 		DBGLOG("server acked.");
 	}
-	close(p->fd);
+	if (!handedOff) close(p->fd);
 	
 	/* release data. */
 	if ( 0 == ret ) 
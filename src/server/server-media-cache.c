@@ -0,0 +1,315 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms media info cache.
+ *
+ * Parsed media_info_t are kept per path, together with the file size and
+ * modification time they were parsed from. An entry whose file changed
+ * since is dropped on lookup. The cache is bounded to MEDIA_CACHE_ENTRIES,
+ * least recently used entries go first.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-media-cache.h"
+#include "nms-hash.h"
+
+#define CACHE_MAGIC    0x434d4e53 // "SNMC"
+#define CACHE_VERSION  1
+#define BUCKETS        1024
+#define NIL            (-1)
+
+typedef struct
+{
+	unsigned int  hash;
+	long long     size;
+	long long     mtime;
+	media_info_t  info;
+	char          path[MEDIA_CACHE_PATH_MAX];
+} cache_entry_t;
+
+static pthread_mutex_t    cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static cache_entry_t      entries[MEDIA_CACHE_ENTRIES];
+static short              bucket[BUCKETS];
+static short              chain[MEDIA_CACHE_ENTRIES];
+static short              lruPrev[MEDIA_CACHE_ENTRIES];
+static short              lruNext[MEDIA_CACHE_ENTRIES];
+static short              lruHead = NIL;
+static short              lruTail = NIL;
+static int                used;
+static int                inited;
+static media_cache_stats_t stats;
+
+static void lruUnlink( int e )
+{
+	if (lruPrev[e] != NIL) lruNext[lruPrev[e]] = lruNext[e];
+	else lruHead = lruNext[e];
+	if (lruNext[e] != NIL) lruPrev[lruNext[e]] = lruPrev[e];
+	else lruTail = lruPrev[e];
+}
+
+static void lruPushHead( int e )
+{
+	lruPrev[e] = NIL;
+	lruNext[e] = lruHead;
+	if (lruHead != NIL) lruPrev[lruHead] = e;
+	lruHead = e;
+	if (lruTail == NIL) lruTail = e;
+}
+
+static int find( const char * path, unsigned int h )
+{
+	int e;
+
+	for (e = bucket[h % BUCKETS]; e != NIL; e = chain[e])
+	{
+		if ((entries[e].hash == h) && !strcmp(entries[e].path, path)) return e;
+	}
+	return NIL;
+}
+
+static void unhash( int e )
+{
+	NmsChainRemove(bucket, BUCKETS, chain, e, entries[e].hash);
+}
+
+static void drop( int e )
+{
+	unhash(e);
+	lruUnlink(e);
+	// keep used entries packed, move the last one into the hole.
+	if (e != --used)
+	{
+		int last = used;
+
+		unhash(last);
+		memcpy(&entries[e], &entries[last], sizeof(cache_entry_t));
+		NmsChainAdd(bucket, BUCKETS, chain, e, entries[e].hash);
+
+		// take over its place in LRU order as well.
+		lruPrev[e] = lruPrev[last];
+		lruNext[e] = lruNext[last];
+		if (lruPrev[e] != NIL) lruNext[lruPrev[e]] = e;
+		else lruHead = e;
+		if (lruNext[e] != NIL) lruPrev[lruNext[e]] = e;
+		else lruTail = e;
+	}
+}
+
+static void insert( const char * path, long long size, long long mtime, const media_info_t * info )
+{
+	unsigned int h = NmsHashString(path);
+	int e;
+
+	e = find(path, h);
+	if (e != NIL) lruUnlink(e);
+	else
+	{
+		if (used == MEDIA_CACHE_ENTRIES) drop(lruTail);
+		e = used++;
+		entries[e].hash = h;
+		strcpy(entries[e].path, path);
+		NmsChainAdd(bucket, BUCKETS, chain, e, h);
+	}
+	entries[e].size = size;
+	entries[e].mtime = mtime;
+	memcpy(&entries[e].info, info, sizeof(media_info_t));
+	lruPushHead(e);
+}
+
+static void reset( void )
+{
+	memset(bucket, NIL, sizeof(bucket));
+	lruHead = lruTail = NIL;
+	used = 0;
+	inited = 1;
+}
+
+/**
+ * Initialize media info cache, restoring persisted entries if any.
+ */
+void
+MediaCacheInit( void )
+{
+	pthread_mutex_lock(&cacheMutex);
+	reset();
+#ifdef MEDIA_CACHE_FILE
+	{
+		FILE * fp;
+		unsigned int hdr[4];
+		cache_entry_t ce;
+		int n;
+
+		fp = fopen(MEDIA_CACHE_FILE, "rb");
+		if (fp)
+		{
+			if ((fread(hdr, sizeof(hdr), 1, fp) == 1) && (hdr[0] == CACHE_MAGIC) &&
+				(hdr[1] == CACHE_VERSION) && (hdr[2] == sizeof(cache_entry_t)))
+			{
+				// stored least recent first, so each insert lands at head.
+				n = hdr[3];
+				if (n > MEDIA_CACHE_ENTRIES) n = MEDIA_CACHE_ENTRIES;
+				while (n-- && (fread(&ce, sizeof(ce), 1, fp) == 1))
+				{
+					ce.path[MEDIA_CACHE_PATH_MAX - 1] = 0;
+					insert(ce.path, ce.size, ce.mtime, &ce.info);
+				}
+			}
+			fclose(fp);
+		}
+		DBGLOG("%d media info entries restored.", used);
+	}
+#endif
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+/**
+ * Persist media info cache, if persistence is enabled.
+ */
+void
+MediaCacheSave( void )
+{
+#ifdef MEDIA_CACHE_FILE
+	FILE * fp;
+	unsigned int hdr[4];
+	int e;
+	int ok = 1;
+
+	pthread_mutex_lock(&cacheMutex);
+	if (!inited) goto bail;
+
+	fp = fopen(MEDIA_CACHE_FILE ".tmp", "wb");
+	if (!fp) goto bail;
+
+	hdr[0] = CACHE_MAGIC;
+	hdr[1] = CACHE_VERSION;
+	hdr[2] = sizeof(cache_entry_t);
+	hdr[3] = used;
+	ok = (fwrite(hdr, sizeof(hdr), 1, fp) == 1);
+	for (e = lruTail; ok && (e != NIL); e = lruPrev[e])
+		ok = (fwrite(&entries[e], sizeof(cache_entry_t), 1, fp) == 1);
+
+	ok = !fflush(fp) && !fsync(fileno(fp)) && ok;
+	fclose(fp);
+	
+	// replace old copy only once the new one is complete.
+	if (ok) rename(MEDIA_CACHE_FILE ".tmp", MEDIA_CACHE_FILE);
+	else unlink(MEDIA_CACHE_FILE ".tmp");
+
+ bail:
+	pthread_mutex_unlock(&cacheMutex);
+#endif
+}
+
+/**
+ * Look up cached media info.
+ *
+ * @param path
+ *        file path.
+ * @param st
+ *        current status of file.
+ * @param info
+ *        media info buffer.
+ * @return
+ *        0 if info was cached and file is unchanged since, nonzero otherwise.
+ */
+int
+MediaCacheLookup( const char * path, const struct stat * st, media_info_t * info )
+{
+	int e;
+	int ret = -1;
+
+	pthread_mutex_lock(&cacheMutex);
+	if (!inited) reset();
+
+	e = find(path, NmsHashString(path));
+	if (e != NIL)
+	{
+		if ((entries[e].size == (long long)st->st_size) &&
+			(entries[e].mtime == (long long)st->st_mtime))
+		{
+			memcpy(info, &entries[e].info, sizeof(media_info_t));
+			lruUnlink(e);
+			lruPushHead(e);
+			ret = 0;
+		}
+		else
+		{
+			// file changed since it was parsed.
+			drop(e);
+			stats.invalidations++;
+		}
+	}
+	if (ret) stats.misses++;
+	else stats.hits++;
+	pthread_mutex_unlock(&cacheMutex);
+
+	return ret;
+}
+
+/**
+ * Cache media info of a file.
+ *
+ * @param path
+ *        file path.
+ * @param st
+ *        status of file the info was parsed from.
+ * @param info
+ *        media info.
+ */
+void
+MediaCacheStore( const char * path, const struct stat * st, const media_info_t * info )
+{
+	if (strlen(path) >= MEDIA_CACHE_PATH_MAX) return;
+
+	pthread_mutex_lock(&cacheMutex);
+	if (!inited) reset();
+	insert(path, st->st_size, st->st_mtime, info);
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+/**
+ * Get cache statistics.
+ *
+ * @param s
+ *        statistics buffer.
+ */
+void
+MediaCacheGetStats( media_cache_stats_t * s )
+{
+	pthread_mutex_lock(&cacheMutex);
+	memcpy(s, &stats, sizeof(stats));
+	s->entries = used;
+	pthread_mutex_unlock(&cacheMutex);
+}
@@ -0,0 +1,52 @@
+#ifndef NMS_SERVER_MEDIA_CACHE__H
+#define NMS_SERVER_MEDIA_CACHE__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms media info cache header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "nc-type.h"
+#include "com-nms.h"
+#include "server-nms.h"
+
+#define MEDIA_CACHE_ENTRIES  512
+#define MEDIA_CACHE_PATH_MAX 260
+// comment this out to keep the cache in memory only.
+#define MEDIA_CACHE_FILE     "/mnt/OSD/.nms-mediainfo"
+
+void MediaCacheInit(void);
+void MediaCacheSave(void);
+int  MediaCacheLookup(const char *, const struct stat *, media_info_t *);
+void MediaCacheStore(const char *, const struct stat *, const media_info_t *);
+void MediaCacheGetStats(media_cache_stats_t *);
+
+#endif /* NMS_SERVER_MEDIA_CACHE__H */
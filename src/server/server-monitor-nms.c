@@ -24,6 +24,8 @@
  *
  * REVISION:
  * 
+ * 8) Keep monitor video for recording pre-roll. --------- 2026-10-19
+ * 7) Monitor loop scheduled by its role policy. --------- 2026-10-19
  * 6) Changed monitor logic to improve stability ---------- 2008-01-03 nerochiaro
  * 5) Cleaned up mutex usage. ----------------------------- 2007-12-14 MG
  * 4) Added in background preference support. ------------- 2007-08-07 MG
@@ -44,6 +46,9 @@
 #include "server-nms.h"
 #include "nmsplugin.h"
 #include "plugin-internals.h"
+#include "server-sched.h"
+#include "server-rec-segment.h"
+#include "server-rec-preroll.h"
 
 // thread safe variables.
 static int              monitor = 0;
@@ -82,6 +87,8 @@ static unsigned int     suppressionCount = 0;
 static void * mLoop(void *arg)
 {
 	static media_buf_t        buf;
+
+	SchedApply(SR_MONITOR);
 	while (1)
 	{
 		LOCK_MMUTEX();
@@ -94,6 +101,7 @@ static void * mLoop(void *arg)
 
 		if (0 == EncInputGetBuffer(0, &buf, 100))
 		{
+			if (PrerollActive()) PrerollPush(&buf);
 			EncInputPutBuffer(0, &buf);
 		}
 		//We do NOT deal with audio now because,
@@ -175,6 +183,7 @@ static int start_srv(void)
 		if (!EncInputInit(&mdesc, out_ntsc_pal))
 		{
 			EncInputStart();
+			PrerollStart(&mdesc);
 
 			LOCK_MMUTEX();
 			mReady = 1;	
@@ -203,6 +212,30 @@ static int start_srv(void)
 	return 0;
 }
 
+/**
+ * Set how much monitor video is kept to start recordings with.
+ *
+ * @param seconds
+ *        pre-roll length, 0 for off.
+ */
+void
+SrvSetPreroll( int seconds )
+{
+	PrerollSet(seconds);
+}
+
+/**
+ * Get pre-roll setting and what is kept now.
+ *
+ * @param info
+ *        info buffer.
+ */
+void
+SrvGetPreroll( rec_preroll_info_t * info )
+{
+	PrerollGetInfo(info);
+}
+
 #define SIGNAL_AND_UNLOCK(condition, mutex) { pthread_cond_signal(condition); pthread_mutex_unlock(mutex); }
 
 /**
@@ -22,13 +22,30 @@
  *
  * Neuros-Cooler platform nms playback history server module.
  *
+ * History is a table of PLAY_HISTORY_SLOTS fixed size records kept in 
+ * PLAY_HISTORY_FILE, one per file ever played. Each update rewrites a 
+ * single record in place, records carry their own checksum so that a 
+ * torn write only loses that one bookmark. Lookups go through an in-memory
+ * hash index, recency is tracked with an LRU list rebuilt from the record 
+ * stamps at load time.
+ *
  * REVISION:
  * 
+ * 4) Sync aged updates on a timer. ---------------------- 2026-10-19
+ * 3) Keep shuffle order with entries. ------------------- 2026-10-19
+ * 2) Persistent per-file bookmark store. ----------------- 2026-10-19
  * 1) Initial creation. ----------------------------------- 2006-09-04 MG 
  *
  */
 
 #include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
 #include "cmd-nms.h"
 #include "com-nms.h"
 #include "server-nms.h"
@@ -37,11 +54,285 @@
 #include "dirtree.h"
 #include "file-helper.h"
 #include "server-play-history.h"
+#include "nms-hash.h"
+
+#define HISTORY_MAGIC    0x484d4e53 // "SNMH"
+#define HISTORY_VERSION  2
+#define HASH_SLOTS       (PLAY_HISTORY_SLOTS * 2)
+#define NIL              (-1)
+
+typedef struct
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int slots;
+	unsigned int reclen;
+} history_hdr_t;
+
+/// on-disk bookmark record
+typedef struct
+{
+	unsigned int crc;    ///checksum over the rest of the record
+	unsigned int hash;   ///path hash, 0 for an unused slot
+	unsigned int stamp;  ///recency stamp, bigger is more recent
+	int  type;           ///playback type NPT_xxx
+	int  fileIdx;        ///file index
+	int  mark;           ///bookmark
+	unsigned int shuffleSeed; ///shuffle order, 0 if none saved
+	int  shufflePos;     ///position in shuffle order
+	char path[260];      ///full path to playable contents
+} history_rec_t;
+
+static pthread_mutex_t    historyMutex = PTHREAD_MUTEX_INITIALIZER;
+static history_rec_t      recs[PLAY_HISTORY_SLOTS];
+static short              lruPrev[PLAY_HISTORY_SLOTS];
+static short              lruNext[PLAY_HISTORY_SLOTS];
+static short              hashIdx[HASH_SLOTS];
+static int                lruHead = NIL; // most recently played
+static int                lruTail = NIL; // first to be evicted
+static int                freeSlot;      // slots below are all in use
+static unsigned int       stampNow;
+static int                historyFd = -1;
+static int                unsynced;
+static time_t             lastSync;
+
+static unsigned int pathHash( const char * path )
+{
+	unsigned int h = NmsHashString(path);
+	return h? h : 1; // 0 marks unused slots.
+}
+
+static unsigned int recCrc( const history_rec_t * r )
+{
+	return NmsHash(&r->hash, sizeof(history_rec_t) - sizeof(r->crc), NMS_HASH_SEED);
+}
+
+/* ---------------- hash index, linear probing. ---------------- */
+
+static int hashFind( const char * path, unsigned int h )
+{
+	int i = h % HASH_SLOTS;
+
+	while (hashIdx[i] != NIL)
+	{
+		history_rec_t * r = &recs[hashIdx[i]];
+		if ((r->hash == h) && !strcmp(r->path, path)) return hashIdx[i];
+		i = (i + 1) % HASH_SLOTS;
+	}
+	return NIL;
+}
+
+static void hashInsert( int slot )
+{
+	int i = recs[slot].hash % HASH_SLOTS;
+
+	while (hashIdx[i] != NIL) i = (i + 1) % HASH_SLOTS;
+	hashIdx[i] = slot;
+}
+
+static void hashRemove( int slot )
+{
+	int i, j;
+
+	i = recs[slot].hash % HASH_SLOTS;
+	while (hashIdx[i] != slot) i = (i + 1) % HASH_SLOTS;
+
+	// backward shift the rest of the probe chain, no tombstones needed.
+	j = i;
+	while (1)
+	{
+		int home;
+
+		j = (j + 1) % HASH_SLOTS;
+		if (hashIdx[j] == NIL) break;
+		home = recs[hashIdx[j]].hash % HASH_SLOTS;
+		if ((i <= j)? ((home <= i) || (home > j)) : ((home <= i) && (home > j)))
+		{
+			hashIdx[i] = hashIdx[j];
+			i = j;
+		}
+	}
+	hashIdx[i] = NIL;
+}
+
+/* ---------------- LRU list. ---------------- */
+
+static void lruUnlink( int slot )
+{
+	if (lruPrev[slot] != NIL) lruNext[lruPrev[slot]] = lruNext[slot];
+	else lruHead = lruNext[slot];
+	if (lruNext[slot] != NIL) lruPrev[lruNext[slot]] = lruPrev[slot];
+	else lruTail = lruPrev[slot];
+}
+
+static void lruPushHead( int slot )
+{
+	lruPrev[slot] = NIL;
+	lruNext[slot] = lruHead;
+	if (lruHead != NIL) lruPrev[lruHead] = slot;
+	lruHead = slot;
+	if (lruTail == NIL) lruTail = slot;
+}
+
+/* ---------------- persistence. ---------------- */
+
+static void syncHistory( int force )
+{
+	if ((historyFd < 0) || !unsynced) return;
+
+	if (force || (unsynced >= PLAY_HISTORY_SYNC_BATCH) ||
+		(time(NULL) - lastSync >= PLAY_HISTORY_SYNC_SECS))
+	{
+		fdatasync(historyFd);
+		unsynced = 0;
+		lastSync = time(NULL);
+	}
+}
+
+static void writeRec( int slot )
+{
+	off_t off;
+
+	recs[slot].crc = recCrc(&recs[slot]);
+	if (historyFd < 0) return;
+
+	off = sizeof(history_hdr_t) + (off_t)slot * sizeof(history_rec_t);
+	if (pwrite(historyFd, &recs[slot], sizeof(history_rec_t), off) != sizeof(history_rec_t))
+		WPRINT("unable to write play history record.");
+	unsynced++;
+	syncHistory(0);
+}
+
+static int byStamp( const void * a, const void * b )
+{
+	unsigned int sa = recs[*(const short *)a].stamp;
+	unsigned int sb = recs[*(const short *)b].stamp;
+
+	return (sa < sb)? 1 : (sa > sb)? -1 : 0;
+}
+
+static void resetTable( void )
+{
+	memset(recs, 0, sizeof(recs));
+	memset(hashIdx, NIL, sizeof(hashIdx));
+	lruHead = lruTail = NIL;
+	freeSlot = 0;
+	stampNow = 0;
+}
+
+static int createFile( void )
+{
+	history_hdr_t hdr;
+
+	hdr.magic = HISTORY_MAGIC;
+	hdr.version = HISTORY_VERSION;
+	hdr.slots = PLAY_HISTORY_SLOTS;
+	hdr.reclen = sizeof(history_rec_t);
+
+	if ((ftruncate(historyFd, 0) != 0) ||
+		(pwrite(historyFd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) ||
+		(pwrite(historyFd, recs, sizeof(recs), sizeof(hdr)) != sizeof(recs)))
+		return -1;
+	fdatasync(historyFd);
+	return 0;
+}
 
-static play_history_t history =
-  {
-	.yes = 0, // history not available.
-  };
+/** 
+ * Load play history from disk.
+ * Entries failing their checksum are dropped, a missing or foreign
+ * file is recreated empty. History is kept in memory only if the file
+ * can not be used.
+ *
+ * @return
+ *        0 if persistent history is available, nonzero otherwise.
+ */
+int
+PlayHistoryInit( void )
+{
+	history_hdr_t hdr;
+	short order[PLAY_HISTORY_SLOTS];
+	int n = 0;
+	int ii;
+
+	pthread_mutex_lock(&historyMutex);
+	resetTable();
+
+	historyFd = open(PLAY_HISTORY_FILE, O_RDWR | O_CREAT, 0644);
+	if (historyFd < 0)
+	{
+		WPRINT("play history not persistent: %s", strerror(errno));
+		goto bail;
+	}
+
+	if ((pread(historyFd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) ||
+		(hdr.magic != HISTORY_MAGIC) || (hdr.version != HISTORY_VERSION) ||
+		(hdr.slots != PLAY_HISTORY_SLOTS) || (hdr.reclen != sizeof(history_rec_t)) ||
+		(pread(historyFd, recs, sizeof(recs), sizeof(hdr)) != sizeof(recs)))
+	{
+		DBGLOG("creating new play history.");
+		resetTable();
+		if (createFile())
+		{
+			WPRINT("unable to create play history.");
+			close(historyFd);
+			historyFd = -1;
+		}
+		goto bail;
+	}
+
+	for (ii = 0; ii < PLAY_HISTORY_SLOTS; ii++)
+	{
+		history_rec_t * r = &recs[ii];
+
+		if (!r->hash) continue;
+		if ((r->crc != recCrc(r)) || (r->hash != pathHash(r->path)))
+		{
+			WPRINT("dropping damaged play history record.");
+			memset(r, 0, sizeof(history_rec_t));
+			continue;
+		}
+		if (r->stamp > stampNow) stampNow = r->stamp;
+		order[n++] = ii;
+	}
+
+	// rebuild recency order, most recent first.
+	qsort(order, n, sizeof(short), byStamp);
+	for (ii = n; ii--; ) 
+	{
+		lruPushHead(order[ii]);
+		hashInsert(order[ii]);
+	}
+	while ((freeSlot < PLAY_HISTORY_SLOTS) && recs[freeSlot].hash) freeSlot++;
+	DBGLOG("%d play history records loaded.", n);
+
+ bail:
+	lastSync = time(NULL);
+	pthread_mutex_unlock(&historyMutex);
+	return (historyFd < 0);
+}
+
+/**
+ * Commit pending history updates to disk.
+ */
+void
+PlayHistoryFlush( void )
+{
+	pthread_mutex_lock(&historyMutex);
+	syncHistory(1);
+	pthread_mutex_unlock(&historyMutex);
+}
+
+/**
+ * Commit history updates pending for PLAY_HISTORY_SYNC_SECS, called 
+ * periodically so they do not wait for the next update.
+ */
+void
+PlayHistoryTick( void )
+{
+	pthread_mutex_lock(&historyMutex);
+	syncHistory(0);
+	pthread_mutex_unlock(&historyMutex);
+}
 
 /** set play history. 
  *
@@ -58,19 +349,55 @@ static play_history_t history =
 void 
 SetPlayHistory(int type, int fileIdx, int mark, const char * path)
 {
-	history.type = type;
-	history.fileIdx = fileIdx;
-	history.mark = mark;
-	//FIXME: buffer overflow check
-	strcpy(history.path, path);
+	unsigned int h;
+	int slot;
+
+	if (strlen(path) >= sizeof(recs[0].path))
+	{
+		WPRINT("path too long for play history.");
+		return;
+	}
+
+	pthread_mutex_lock(&historyMutex);
+	h = pathHash(path);
+	slot = hashFind(path, h);
+	if (slot != NIL)
+	{
+		lruUnlink(slot);
+	}
+	else
+	{
+		if (freeSlot < PLAY_HISTORY_SLOTS)
+		{
+			slot = freeSlot;
+			while ((freeSlot < PLAY_HISTORY_SLOTS) && recs[freeSlot].hash) freeSlot++;
+		}
+		else
+		{
+			// evict least recently played.
+			slot = lruTail;
+			lruUnlink(slot);
+			hashRemove(slot);
+		}
+		memset(&recs[slot], 0, sizeof(history_rec_t));
+		recs[slot].hash = h;
+		strcpy(recs[slot].path, path);
+		hashInsert(slot);
+	}
 
-    history.yes = 1;
+	recs[slot].type = type;
+	recs[slot].fileIdx = fileIdx;
+	recs[slot].mark = mark;
+	recs[slot].stamp = ++stampNow;
+	lruPushHead(slot);
+	writeRec(slot);
+	pthread_mutex_unlock(&historyMutex);
 }
 
 /** get play history.
  *
  * @param his
- *        current history if available.
+ *        most recently played history if available.
  * @return
  *        0 if history successfully fetched, nonzero otherwise.
  *
@@ -78,10 +405,117 @@ SetPlayHistory(int type, int fileIdx, int mark, const char * path)
 int
 GetPlayHistory(play_history_t * his)
 {
-    if (history.yes)
-	  {
-		memcpy(his, &history, sizeof(history));
-		return 0;
-	  }
-	return -1;
+	int ret = -1;
+
+	pthread_mutex_lock(&historyMutex);
+	if (lruHead != NIL)
+	{
+		history_rec_t * r = &recs[lruHead];
+
+		his->yes = 1;
+		his->type = r->type;
+		his->fileIdx = r->fileIdx;
+		his->mark = r->mark;
+		strcpy(his->path, r->path);
+		ret = 0;
+	}
+	pthread_mutex_unlock(&historyMutex);
+	return ret;
+}
+
+/** get bookmark of a given file.
+ *
+ * @param path
+ *        full path to file.
+ * @param mark
+ *        bookmark if available.
+ * @return
+ *        0 if bookmark found, nonzero otherwise.
+ */
+int
+GetPlayBookmark(const char * path, int * mark)
+{
+	int slot;
+
+	pthread_mutex_lock(&historyMutex);
+	slot = hashFind(path, pathHash(path));
+	if (slot != NIL) *mark = recs[slot].mark;
+	pthread_mutex_unlock(&historyMutex);
+
+	return (slot == NIL);
+}
+
+/** forget bookmark of a file which has been played through.
+ *  File recency is not changed.
+ *
+ * @param path
+ *        full path to file.
+ */
+void
+ClearPlayBookmark(const char * path)
+{
+	int slot;
+
+	pthread_mutex_lock(&historyMutex);
+	slot = hashFind(path, pathHash(path));
+	if ((slot != NIL) && recs[slot].mark)
+	{
+		recs[slot].mark = 0;
+		writeRec(slot);
+	}
+	pthread_mutex_unlock(&historyMutex);
+}
+
+/** remember shuffle order of a played entry, recency is not changed.
+ *
+ * @param path
+ *        full path, as recorded with SetPlayHistory().
+ * @param seed
+ *        shuffle seed.
+ * @param pos
+ *        position in shuffle order.
+ */
+void
+SetPlayShuffle(const char * path, unsigned int seed, int pos)
+{
+	int slot;
+
+	pthread_mutex_lock(&historyMutex);
+	slot = hashFind(path, pathHash(path));
+	if (slot != NIL)
+	{
+		recs[slot].shuffleSeed = seed;
+		recs[slot].shufflePos = pos;
+		writeRec(slot);
+	}
+	pthread_mutex_unlock(&historyMutex);
+}
+
+/** get shuffle order saved with an entry.
+ *
+ * @param path
+ *        full path.
+ * @param seed
+ *        shuffle seed if available.
+ * @param pos
+ *        position in shuffle order if available.
+ * @return
+ *        0 if shuffle order found, nonzero otherwise.
+ */
+int
+GetPlayShuffle(const char * path, unsigned int * seed, int * pos)
+{
+	int slot;
+	int ret = -1;
+
+	pthread_mutex_lock(&historyMutex);
+	slot = hashFind(path, pathHash(path));
+	if ((slot != NIL) && recs[slot].shuffleSeed)
+	{
+		*seed = recs[slot].shuffleSeed;
+		*pos = recs[slot].shufflePos;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&historyMutex);
+	return ret;
 }
@@ -27,6 +27,9 @@
  * REVISION:
  * 
  * 
+ * 4) Added periodic sync. ------------------------------- 2026-10-19
+ * 3) Keep shuffle order with entries. ------------------- 2026-10-19
+ * 2) Persistent per-file bookmark store. ----------------- 2026-10-19
  * 1) Initial creation. ----------------------------------- 2006-09-04 MG 
  *
  */
@@ -41,6 +44,12 @@
 
 #include "nc-type.h"
 
+/* on-disk bookmark store, one fixed size slot per file. */
+#define PLAY_HISTORY_FILE       "/mnt/OSD/.nms-history"
+#define PLAY_HISTORY_SLOTS      4096 // files remembered, least recently played evicted first.
+#define PLAY_HISTORY_SYNC_BATCH 16   // updates between fsyncs
+#define PLAY_HISTORY_SYNC_SECS  30   // max seconds an update stays unsynced, see PlayHistoryTick()
+
 /// player history management
 typedef struct
 {
@@ -52,7 +61,14 @@ typedef struct
 } play_history_t;
 
 
+int  PlayHistoryInit(void);
+void PlayHistoryFlush(void);
+void PlayHistoryTick(void);
 void SetPlayHistory(int, int, int, const char*);
 int  GetPlayHistory(play_history_t *);
+int  GetPlayBookmark(const char*, int *);
+void ClearPlayBookmark(const char*);
+void SetPlayShuffle(const char*, unsigned int, int);
+int  GetPlayShuffle(const char*, unsigned int *, int *);
 
 #endif /* NMS_SERVER_PLAY_HISTORY__H */
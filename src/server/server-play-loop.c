@@ -0,0 +1,245 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms repeat A-B loop buffer.
+ *
+ * The first pass through an A-B segment is read from the input plugin as
+ * usual, every demuxed frame is copied aside on the way to the output. 
+ * Once the whole segment is retained, the following loops are fed from 
+ * memory, so looping costs neither a seek nor any disk I/O. The first
+ * frame past B is retained too: replay ends once the output plays past B,
+ * and it must have a frame to get there.
+ *
+ * REVISION:
+ * 
+ * 2) Retain the frame crossing B. ------------------------ 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "nmsplugin.h"
+#include "server-play-loop.h"
+
+#define LOOP_FRAMES_STEP  256
+
+typedef enum
+	{
+		LB_IDLE,       // nothing retained.
+		LB_FILLING,    // first pass through the segment.
+		LB_READY,      // whole segment retained, replay from memory.
+		LB_OVERFLOW    // segment does not fit the budget, keep seeking.
+	} LOOP_BUFFER_STATE;
+
+/// demuxed frame retained for replay
+typedef struct
+{
+	int     audio;  ///1: audio frame 0: video frame
+	q_buf_t hdr;    ///buffer header as returned by the input
+	void *  data;   ///private copy of the frame payload
+} loop_frame_t;
+
+static LOOP_BUFFER_STATE  state = LB_IDLE;
+static loop_frame_t *     frames;
+static int                frameCnt;
+static int                frameMax;
+static int                cursor;
+static unsigned long      bytes;
+static int                segA;
+static int                segB;
+static int                segStart; // time stamp the first pass started from.
+
+static void dropFrames( void )
+{
+	while (frameCnt) free(frames[--frameCnt].data);
+	bytes = 0;
+	cursor = 0;
+}
+
+/**
+ * Drop everything retained and stop capturing.
+ */
+void
+LoopBufferReset( void )
+{
+	dropFrames();
+	free(frames);
+	frames = NULL;
+	frameMax = 0;
+	state = LB_IDLE;
+}
+
+/**
+ * Start retaining frames for a new pass through the A-B segment.
+ * Call this right after the input has been repositioned at A.
+ *
+ * @param a
+ *        segment start in mili-seconds.
+ * @param b
+ *        segment end in mili-seconds.
+ * @param start
+ *        time stamp the input actually landed on.
+ */
+void
+LoopBufferArm( int a, int b, int start )
+{
+	dropFrames();
+	segA = a;
+	segB = b;
+	segStart = start;
+	state = LB_FILLING;
+}
+
+/**
+ * @return
+ *        nonzero if first pass frames are being retained.
+ */
+int
+LoopBufferIsFilling( void )
+{
+	return (state == LB_FILLING);
+}
+
+/**
+ * Retain a copy of the frame just read from the input. Capturing stops
+ * by itself once the first frame beyond B is retained, or once the budget
+ * is used up.
+ *
+ * @param buf
+ *        media buffer filled by InputGetData.
+ */
+void
+LoopBufferStore( const media_buf_t * buf )
+{
+	loop_frame_t * f;
+	const q_buf_t * q = buf->curbuf;
+
+	if (state != LB_FILLING) return;
+
+	if ((q->size <= 0) || (bytes + q->size > LOOP_BUFFER_BUDGET))
+		goto overflow;
+
+	if (frameCnt == frameMax)
+	{
+		loop_frame_t * p;
+
+		p = realloc(frames, (frameMax + LOOP_FRAMES_STEP) * sizeof(loop_frame_t));
+		if (!p) goto overflow;
+		frames = p;
+		frameMax += LOOP_FRAMES_STEP;
+	}
+
+	f = &frames[frameCnt];
+	f->data = malloc(q->size);
+	if (!f->data) goto overflow;
+	memcpy(f->data, q->data, q->size);
+	memcpy(&f->hdr, q, sizeof(q_buf_t));
+	f->audio = (q == &buf->abuf);
+
+	frameCnt++;
+	bytes += q->size;
+	if (q->tsms > segB)
+	{
+		DBGLOG("A-B segment retained: %d frames, %lu bytes.", frameCnt, bytes);
+		state = LB_READY;
+	}
+	return;
+
+ overflow:
+	WPRINT("A-B segment exceeds loop buffer, falling back to seek.");
+	dropFrames();
+	state = LB_OVERFLOW;
+}
+
+/**
+ * @param a
+ *        current segment start.
+ * @param b
+ *        current segment end.
+ * @return
+ *        nonzero if the given segment can be replayed from memory.
+ */
+int
+LoopBufferIsReady( int a, int b )
+{
+	return ((state == LB_READY) && (a == segA) && (b == segB));
+}
+
+/**
+ * Restart replay from the beginning of the segment.
+ *
+ * @return
+ *        time stamp to flush the output to.
+ */
+int
+LoopBufferRewind( void )
+{
+	cursor = 0;
+	return segStart;
+}
+
+/**
+ * @return
+ *        nonzero if every retained frame has been replayed.
+ */
+int
+LoopBufferEnd( void )
+{
+	return (cursor >= frameCnt);
+}
+
+/**
+ * Copy next retained frame into an output buffer, in place of InputGetData.
+ *
+ * @param buf
+ *        media buffer fetched from OutputGetBuffer.
+ * @return
+ *        frame size in bytes, negative if frame does not fit the buffer.
+ */
+int
+LoopBufferFetch( media_buf_t * buf )
+{
+	loop_frame_t * f;
+	q_buf_t * q;
+	void * data;
+
+	if (cursor >= frameCnt) return -1;
+	f = &frames[cursor];
+
+	q = f->audio? &buf->abuf : &buf->vbuf;
+	if (!q->data || (f->hdr.size > q->size)) return -1;
+
+	// keep the output plugin's own data pointer.
+	data = q->data;
+	memcpy(q, &f->hdr, sizeof(q_buf_t));
+	q->data = data;
+	memcpy(q->data, f->data, f->hdr.size);
+	buf->curbuf = q;
+
+	cursor++;
+	return f->hdr.size;
+}
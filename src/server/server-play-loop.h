@@ -0,0 +1,53 @@
+#ifndef NMS_SERVER_PLAY_LOOP__H
+#define NMS_SERVER_PLAY_LOOP__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms repeat A-B loop buffer header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include "nc-type.h"
+#include "nmsplugin.h"
+
+/* memory budget for one A-B segment, longer segments fall back to seeking. */
+#define LOOP_BUFFER_BUDGET  (6 * 1024 * 1024)
+
+/*
+ * The loop buffer is owned by the playback thread, none of these 
+ * routines is thread-safe, nor do they need to be.
+ */
+void LoopBufferReset(void);
+void LoopBufferArm(int, int, int);
+int  LoopBufferIsFilling(void);
+void LoopBufferStore(const media_buf_t *);
+int  LoopBufferIsReady(int, int);
+int  LoopBufferRewind(void);
+int  LoopBufferEnd(void);
+int  LoopBufferFetch(media_buf_t *);
+
+#endif /* NMS_SERVER_PLAY_LOOP__H */
@@ -24,6 +24,18 @@
  *
  * REVISION:
  *
+ * 17) Run playback loops on persistent engine threads. 2026-10-19
+ * 16) Bounded stop latency, cancel pending work. ------- 2026-10-19
+ * 15) Shuffle without repeats, resumable. --------------- 2026-10-19
+ * 14) Recursive directory tree playback. ---------------- 2026-10-19
+ * 13) Reuse cached listings of directories played before. 2026-10-19
+ * 12) Stream directory listing without holding play lock. 2026-10-19
+ * 11) Skip files known to be unplayable in directory mode. 2026-10-19
+ * 10) Parse media info once per file open. --------------- 2026-10-19
+ * 9) Serve media info from cache when file is unchanged. - 2026-10-19
+ * 8) Streaming playlist playback. ----------------------- 2026-10-19
+ * 7) Resume files from their persistent bookmark. ------- 2026-10-19
+ * 6) Replay repeat A-B segment from memory. -------------- 2026-10-19
  * 5) Server mutex and state machine cleanup, only one mutex is needed
  *    to protect various server state and control flags, also to protect
  *    simultaneous access to non-reentrant APIs. ---------- 2007-12-14 MG
@@ -37,6 +49,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sched.h>
+#include <sys/time.h>
 
 //#define LOG_TIME_STAMP__
 //#define OSD_DBG_MSG
@@ -50,18 +63,27 @@
 #include "dirtree.h"
 #include "file-helper.h"
 #include "server-play-history.h"
+#include "server-play-loop.h"
+#include "server-playlist.h"
+#include "server-media-cache.h"
+#include "server-bad-files.h"
+#include "server-dir-list.h"
+#include "server-dir-cache.h"
+#include "server-dir-tree.h"
+#include "server-shuffle.h"
+#include "server-engine.h"
 
 // define this to playback video only
 #define PLAY_VIDEO_FILE_ONLY
 
-#define F_INDEX(index)    	((index < node.fdnum)?				\
-							 node.fdindex[index]:				\
-							 node.ffindex[index-node.fdnum]) 
-#define D_NAME(index)		(node.namelist[index]->d_name)
-#define D_PATH				(node.path)
+// define this to resume every file from its last bookmark
+#define RESUME_FROM_BOOKMARK
+#define RESUME_MIN_MARK   5000    // bookmarks closer to the start are ignored, unit: mili-second
 
 
 #define DRAIN_POLL_TICK 200000  // unit: micro-second
+#define LOOP_IDLE_TICK  20000   // unit: micro-second
+#define STOP_LATENCY_BUDGET 500 // stops taking longer are logged, unit: mili-second
 
 //FIXME: Should be a method to calculate the scan step dynamicly.
 #define SCAN_STEP1_MS   50      // scan step in mili-seconds, for ffrw level <= 2.
@@ -71,7 +93,8 @@
 typedef enum
 	{
 		PM_SINGLE,
-		PM_FOLDER
+		PM_FOLDER,
+		PM_TREE     // folder and all folders below it.
 	} PLAY_MODE;
 
 typedef enum
@@ -90,12 +113,8 @@ typedef enum
 	} TRACK_CHANGE;
 
 
-// thread variables (thread, mutex, and conditionals) themselves 
-// are thread-safe for sure.
-static pthread_t          avThread = (pthread_t)NULL; 
-static pthread_t          dirInitThread = (pthread_t)NULL;
-static pthread_t          nextFileThread = (pthread_t)NULL;
-
+// thread variables (mutex, and conditionals) themselves 
+// are thread-safe for sure. Loops run on engine threads, see server-engine.c.
 // mutex fast forward, server main thread and playback thread
 static pthread_mutex_t    playMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t     playdirCond = PTHREAD_COND_INITIALIZER;
@@ -125,6 +144,7 @@ static int                fileIdx;   // active playing file index, starts from 0
 static int                totalFiles;// total number of playable contents
 static int                fileCnt;   // played file counter
 static char               trackName[PATH_MAX];
+static char               curFile[PATH_MAX]; // file being played, in any play type.
 static int                errorStatus;// play status
 static int                everPlayed;// have we ever played successfully.
 static int                playtype;  // playback type
@@ -133,19 +153,22 @@ static int                playtype;  // playback type
 // player mode controls
 static int                editmode = 0; // 0: play 1: edit
 static REPEAT_MODE        repeat = RM_REPEAT;// 0: Normal 1: Repeat 2: Shuffle
-static PLAY_MODE          playmode;  // 0: single 1: Folder
+static PLAY_MODE          playmode;  // 0: single 1: Folder 2: Tree
 static TRACK_CHANGE       trackChange;  
 static int                firstplay; //the index of the file that we first play
 
 
 // directory playback support
 static int                dirInited = 0;
+static int                dirListed; // listing complete, totalFiles final.
+static int                scannedFiles; // entries read by a listing not published yet.
 static char               dirName[PATH_MAX];
 #define DPAV_NOT_DETERMINED_ 0
 #define DPAV_AUDIO_          1
 #define DPAV_VIDEO_          2
 static int                dirPlayAV; 
-static dir_node_t         node;
+static int                trackListed; // playing file located in directory listing.
+static int                dirTree;   // directory played as a tree, fixed while directory threads run.
 
 static NMS_SRV_STATUS_t   playState;
 static NMS_SRV_PLAYBACK_REPEAT_STATUS_t rptState = NMS_PLAYBACK_REPEAT_OFF;
@@ -160,39 +183,38 @@ static int                iSeekFlag;
 static media_info_t       info;
 
 static int                curProportions = 0; // current output proportions. effective only on next playback.
+static stop_latency_stats_t stopStats;
+static struct timeval     changeAsked; // client asked for next or previous track.
 
-static int newThread(pthread_t * thread,
-					 const pthread_attr_t * attr,
-					 void *(*start_routine)(void*), void * arg)
+// playback server stopped or replaced, leave whatever is pending.
+static int playCancelled( void )
 {
-	int status;
-	
-	status = pthread_create(thread, attr, start_routine, arg);
-	if (status)
-	{
-		WPRINT("Thread was not created!");
-		switch (status)
-		{
-		case EAGAIN:
-			EPRINT("The system lacked the necessary resources to create "
-				   "another thread, or the system-imposed limit on the total "
-				   "number of threads in a process {PTHREAD_THREADS_MAX} " 
-				   "would be exceeded.");
-			break;
-		case EINVAL:
-			EPRINT("The value specified by attr is invalid.");
-			break;
-		case EPERM:
-			EPRINT("The caller does not have appropriate permission to "
-				   "set  the  required "
-				   "scheduling  parameters  or scheduling policy.");
-			break;
-		default:
-			EPRINT("Unknown error!");
-			break;
-		}
-	}
-	return status;
+	int cancelled;
+
+	LOCK_PLAYMUTEX();
+	cancelled = !going;
+	UNLOCK_PLAYMUTEX();
+	return cancelled;
+}
+
+// account time taken to stop since start.
+static void noteStopLatency( const struct timeval * start, const char * what )
+{
+	struct timeval now;
+	unsigned int ms;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - start->tv_sec) * 1000 + (now.tv_usec - start->tv_usec) / 1000;
+
+	LOCK_PLAYMUTEX();
+	stopStats.stops++;
+	stopStats.lastMs = ms;
+	if (ms > stopStats.maxMs) stopStats.maxMs = ms;
+	if (ms > STOP_LATENCY_BUDGET) stopStats.slow++;
+	UNLOCK_PLAYMUTEX();
+
+	if (ms > STOP_LATENCY_BUDGET) WPRINT("%s took %u ms.", what, ms);
+	else DBGMSG("%s took %u ms.", what, ms);
 }
 
 static void * avLoop( void * arg )
@@ -210,6 +232,9 @@ static void * avLoop( void * arg )
 	int loc_ffrw_scan_step = 0;
 	media_buf_t loc_buf;
 	long loc_info_duration;
+	int loc_replay = 0; // feeding output from the A-B loop buffer.
+
+	LoopBufferReset();
 
 	LOCK_PLAYMUTEX();
 	if(editmode)
@@ -232,6 +257,15 @@ static void * avLoop( void * arg )
 		/* preload */
 		while (loc_frames < loc_preload)
 		{
+			LOCK_PLAYMUTEX();
+			if (!playing)
+			{
+				// stopped before output even started.
+				UNLOCK_PLAYMUTEX();
+				break;
+			}
+			UNLOCK_PLAYMUTEX();
+
 			if (1 == OutputGetBuffer(&loc_buf, 0, 1))
 			{
 				WPRINT("GetBuffer failed.");
@@ -293,6 +327,21 @@ static void * avLoop( void * arg )
 		}
 		loc_playState = playState;
 		UNLOCK_PLAYMUTEX();
+
+		if (loc_playState != NMS_STATUS_PLAYER_PLAY &&
+			loc_playState != NMS_STATUS_PLAYER_PAUSE)
+		{
+			if (loc_replay)
+			{
+				// trick modes read from the input, bring it back in position.
+				LOCK_PLAYMUTEX();
+				loc_cur_t = InputSeek(playtime);
+				OutputFlush(loc_cur_t);
+				UNLOCK_PLAYMUTEX();
+				loc_replay = 0;
+			}
+			LoopBufferReset();
+		}
 		
 		switch (loc_playState)
 		{
@@ -335,6 +384,8 @@ static void * avLoop( void * arg )
 						{
 							loc_next_t = InputSeek(loc_iBookMark);						
 							OutputFlush(loc_next_t);
+							LoopBufferReset();
+							loc_replay = 0;
 						}
 						LOCK_PLAYMUTEX();
 						iSeekFlag = 0;
@@ -564,12 +615,47 @@ static void * avLoop( void * arg )
 		{
 			loc_cur_t = playtime;
 			if (loc_cur_t > rptB)
-			{				
-				loc_cur_t = InputSeek(rptA);
-				OutputFlush(loc_cur_t);
+			{
+				if (LoopBufferIsReady(rptA, rptB))
+				{
+					// segment is in memory, replay it without touching the input.
+					OutputFlush(LoopBufferRewind());
+					loc_replay = 1;
+				}
+				else
+				{
+					loc_cur_t = InputSeek(rptA);
+					OutputFlush(loc_cur_t);
+					if (loc_replay)
+					{
+						LoopBufferReset();
+						loc_replay = 0;
+					}
+					else if (loc_preState == NMS_STATUS_PLAYER_PLAY)
+						LoopBufferArm(rptA, rptB, loc_cur_t);
+				}
 			}
 		}
+		else if (loc_replay)
+		{
+			// repeat is off, carry on from the input where replay left off.
+			loc_cur_t = InputSeek(playtime);
+			OutputFlush(loc_cur_t);
+			LoopBufferReset();
+			loc_replay = 0;
+		}
+		else if (LoopBufferIsFilling()) LoopBufferReset();
 		UNLOCK_PLAYMUTEX();
+
+		if (loc_replay && LoopBufferEnd())
+		{
+			// whole segment queued, wait for output to reach B.
+			usleep(LOOP_IDLE_TICK);
+			LOCK_PLAYMUTEX();
+			playtime = OutputGetPlaytime();
+			UNLOCK_PLAYMUTEX();
+			continue;
+		}
 		
 		if ( 1 == OutputGetBuffer(&loc_buf, 1000, 0))
 		{
@@ -577,7 +663,26 @@ static void * avLoop( void * arg )
 			continue;
 		}
 
-		loc_bytes = InputGetData(&loc_buf);
+		if (loc_replay)
+		{
+			loc_bytes = LoopBufferFetch(&loc_buf);
+			if (loc_bytes < 0)
+			{
+				WPRINT("loop buffer replay failed, back to input.");
+				LOCK_PLAYMUTEX();
+				loc_cur_t = InputSeek(rptA);
+				OutputFlush(loc_cur_t);
+				UNLOCK_PLAYMUTEX();
+				LoopBufferReset();
+				loc_replay = 0;
+				continue;
+			}
+		}
+		else
+		{
+			loc_bytes = InputGetData(&loc_buf);
+			if (loc_bytes > 0) LoopBufferStore(&loc_buf);
+		}
 		if (loc_bytes == 0)
 		{
 			WPRINT("zero bytes returned!");
@@ -646,6 +751,9 @@ static void * avLoop( void * arg )
 	// if quit, re-fetch the lock here
 	
  bail:
+	LoopBufferReset();
+	loc_replay = 0;
+
 	LOCK_PLAYMUTEX();
 	ffrwLevel = 0;
 	sfrwLevel = 0;
@@ -762,6 +870,17 @@ static void * avLoop( void * arg )
 	
 	DBGMSG("input output finished.");
 	
+	if (0 == loc_quit)
+	{
+		char loc_curFile[PATH_MAX];
+
+		// played through, next time starts from the beginning.
+		strcpy(loc_curFile, curFile);
+		UNLOCK_PLAYMUTEX();
+		ClearPlayBookmark(loc_curFile);
+		LOCK_PLAYMUTEX();
+	}
+
 	// check to play next file.
 	if ((0 == loc_quit) && (playtype != NPT_FILE))
 	{
@@ -775,7 +894,7 @@ static void * avLoop( void * arg )
 	}
 	else UNLOCK_PLAYMUTEX();
 
-	pthread_exit(NULL);
+	return NULL;
 }
 
 // make sure playmutex is released before calling this
@@ -800,13 +919,9 @@ static void stopPlaying( void )
 	}
 	UNLOCK_PLAYMUTEX();
 	
-	if (avThread)
-	{
-		DBGMSG("Removing av thread!");
-		pthread_join(avThread, NULL);
-		avThread = (pthread_t)NULL;
-		//DBGMSG("Thread removed!");
-	}
+	DBGMSG("Waiting for av loop!");
+	EngineWait(ENGINE_AV);
+	//DBGMSG("av loop finished!");
 
 	LOCK_PLAYMUTEX();
 	requestToStopPlaying = 0;
@@ -815,12 +930,16 @@ static void stopPlaying( void )
 	DBGMSG("playing is completely stopped.");
 }
 
+// stop playback, latency counted from start, when the request came in.
 static void
-stopServer( void )
+stopServerSince( const struct timeval * start )
 {
+	int busy;
+
 	DBGMSG("stopping playback server");
 	
 	LOCK_PLAYMUTEX();
+	busy = going || playing;
 	going = 0;		
 	preloaded = 1;
 	// quit the nextfile thread first.
@@ -828,32 +947,41 @@ stopServer( void )
 	UNLOCK_PLAYMUTEX();
 	
 	pthread_cond_broadcast(&nextFileCond);
+	// nobody waits for directory entries any more.
+	DirListAbort();
+	TreeAbort();
+	pthread_cond_broadcast(&playdirCond);
 	
-	if (nextFileThread)
-	{
-		DBGMSG("Removing Next file thread!");
-		pthread_join(nextFileThread, NULL);
-		nextFileThread = (pthread_t)NULL;
-		DBGMSG("Next file Thread removed!");
-	}
+	DBGMSG("Waiting for next file loop!");
+	EngineWait(ENGINE_NEXT_FILE);
+	DBGMSG("Next file loop finished!");
 
-	if (dirInitThread)
-	{
-		DBGMSG("Removing Init thread!");
-		pthread_join(dirInitThread, NULL);
-		dirInitThread = (pthread_t)NULL;
-		DBGMSG("Init Thread removed!");
-	}
+	DBGMSG("Waiting for directory init!");
+	EngineWait(ENGINE_DIR_INIT);
+	DBGMSG("Directory init finished!");
 
 	LOCK_PLAYMUTEX();
 	dirInited = 0;
+	dirListed = 0;
 	UNLOCK_PLAYMUTEX();
 	
 	stopPlaying();
+	PlaylistClose();
 	
 	LOCK_PLAYMUTEX();
 	trackChange = TC_DISABLE;
 	UNLOCK_PLAYMUTEX();
+
+	if (busy) noteStopLatency(start, "stop");
+}
+
+static void
+stopServer( void )
+{
+	struct timeval start;
+
+	gettimeofday(&start, NULL);
+	stopServerSince(&start);
 }
 
 static int playFile(const char * file)
@@ -866,7 +994,13 @@ static int playFile(const char * file)
 	memset(&mdesc, 0, sizeof(media_desc_t));
 	mdesc.ftype = NMS_WP_INVALID;
 	
-	if (!InputIsOurFile(file)) return -1;
+	if (playCancelled()) return -1;
+
+	if (!InputIsOurFile(file)) 
+	{
+		BadFileAdd(file, BF_NOT_OURS);
+		return -1;
+	}
 	
 	status = InputInit(file, &mdesc); 
 	
@@ -882,19 +1016,50 @@ static int playFile(const char * file)
 		goto bail_clean_input;
 	default:
 		WPRINT("InputInit: Unable to init device!");
+		BadFileAdd(file, BF_INPUT_INIT);
 		LOCK_PLAYMUTEX();
 		errorStatus = NMS_STATUS_NOT_PLAYABLE;
 		UNLOCK_PLAYMUTEX();
 		goto bail_clean_input;
 	}
 
-	LOCK_PLAYMUTEX();
-	InputGetInfo(file, &info);
-	UNLOCK_PLAYMUTEX();
+	// plugin init may be slow, do not carry on if stopped meanwhile.
+	if (playCancelled())
+	{
+		status = -1;
+		goto bail_clean_input;
+	}
 
+	// media info comes from cache, or from the plugin just selected.
+	{
+		media_info_t loc_info;
+		struct stat st;
+		int cacheable;
+
+		memset(&loc_info, 0, sizeof(media_info_t));
+		cacheable = !stat(file, &st) && S_ISREG(st.st_mode);
+		if (!cacheable || MediaCacheLookup(file, &st, &loc_info))
+		{
+			loc_info.available = 1;
+			if (!InputGetActiveInfo(file, &loc_info) && cacheable)
+				MediaCacheStore(file, &st, &loc_info);
+		}
+
+		LOCK_PLAYMUTEX();
+		memcpy(&info, &loc_info, sizeof(media_info_t));
+		UNLOCK_PLAYMUTEX();
+	}
+
+
+	if (playCancelled())
+	{
+		status = -1;
+		goto bail_clean_input;
+	}
 
 	if (InputStart(file)) 
 	{
+		BadFileAdd(file, BF_INPUT_START);
 		status = -1;
 		goto bail_clean_input;
 	}
@@ -922,6 +1087,13 @@ static int playFile(const char * file)
 	OutputActivateMode(0);
 
 	LOCK_PLAYMUTEX();
+	if (!going)
+	{
+		UNLOCK_PLAYMUTEX();
+		OutputFinish(0);
+		status = -1;
+		goto bail_clean_input;
+	}
 	playtime = 0;
 	ffrwLevel = 0;
 	sfrwLevel = 0;
@@ -929,13 +1101,27 @@ static int playFile(const char * file)
 	muted = 0;
 	playing  = 1;
 	trackChange = TC_DISABLE;
+	strcpy(curFile, file);
 	UNLOCK_PLAYMUTEX();
 	
-	if (newThread(&avThread, NULL, avLoop, NULL)) 
+	if (EngineSubmit(ENGINE_AV, avLoop, NULL)) 
 	{
 		status = -1;
 		goto bail_clean_input;
 	}
+	BadFileClear(file);
+
+#ifdef RESUME_FROM_BOOKMARK
+	{
+		int mark;
+
+		if (!GetPlayBookmark(file, &mark) && (mark > RESUME_MIN_MARK))
+		{
+			DBGLOG("resuming from %d ms.", mark);
+			SrvSeek(mark);
+		}
+	}
+#endif
 	
 	return 0;
 	
@@ -946,96 +1132,185 @@ bail_clean_input:
 	return status;
 }
 
+// drop listing, next scan walks the tree or reads the directory.
+static void listReset( const char * dir )
+{
+	if (dirTree) TreeReset(dir);
+	else DirListReset(dir);
+}
+
+static int listFind( const char * path )
+{
+	return dirTree? TreeFind(path) : DirListFind(path);
+}
+
+static char * listGet( int idx, char * buf, int size, int wait )
+{
+	return dirTree? TreeGet(idx, buf, size, wait) : DirListGet(idx, buf, size, wait);
+}
+
+// directory listing progress, entries are published in batches.
+static void dirProgress( int count )
+{
+	char loc_trackName[PATH_MAX];
+	int idx = -1;
+	int ready;
+
+	LOCK_PLAYMUTEX();
+	totalFiles = count;
+	loc_trackName[0] = 0;
+	if (playing && !trackListed) strcpy(loc_trackName, trackName);
+	UNLOCK_PLAYMUTEX();
+
+	// locating may read a directory, keep it out of the lock.
+	if (loc_trackName[0]) idx = listFind(loc_trackName);
+
+	LOCK_PLAYMUTEX();
+	if ((idx >= 0) && !trackListed)
+	{
+		fileIdx = idx;
+		trackListed = 1;
+	}
+	// next file can be chosen once the playing one is located.
+	ready = !dirInited && count && (!playing || trackListed);
+	if (ready) dirInited = 1;
+	UNLOCK_PLAYMUTEX();
+
+	if (ready) pthread_cond_broadcast(&playdirCond);
+}
+
+// directory scan progress, entries are read but not published yet.
+static void scanProgress( int count )
+{
+	LOCK_PLAYMUTEX();
+	scannedFiles = count;
+	UNLOCK_PLAYMUTEX();
+}
+
+// list directory with given filter, from cache if possible.
+static int listDir( const char * dir, int av, dir_filter_t filter )
+{
+	char * names;
+	int bytes;
+	int cnt;
+	time_t since;
+
+	// trees are walked in order, nothing to cache or sort.
+	if (dirTree) return TreeScan(filter, dirProgress);
+
+	if (!DirCacheLookup(dir, av, filter, &names, &bytes, &cnt))
+	{
+		cnt = DirListLoad(names, bytes, cnt);
+		if (cnt > 0) dirProgress(cnt);
+		return cnt;
+	}
+
+	// indexes are handed out once in name order, so the first file picked
+	// is the first by name and no index changes under a client.
+	since = time(NULL);
+	cnt = DirListScan(filter, scanProgress);
+	if (cnt < 0) return cnt;
+
+	DirListSortPrepare();
+	DirListSortCommit();
+	if (cnt > 0) dirProgress(cnt);
+
+	if (DirListExport(&names, &bytes) >= 0)
+	{
+		DirCacheStore(dir, av, filter, names, bytes, cnt, since);
+		free(names);
+	}
+	return cnt;
+}
+
 // initialize directory.
 // arg: original directory/file name
 // function shall set up the following,
 // 1. filter the directory properly
 // 2. total number of playable contents:  totalFiles
 // 3. current file index:                 fileIdx
+// Tree entries are published as they are walked, a flat directory once
+// completely read and sorted by name.
 static void * dirInit( void * arg )
 {
-	LOCK_PLAYMUTEX();	
-	if (CoolBlockOpenDir(dirName, &node) < 0)
-	{
-		WPRINT("unable to open directory.");
-	}
-	else
-	{
-		//DBGMSG("dirPlayAV = [%d]", dirPlayAV);
-		if (dirPlayAV == DPAV_AUDIO_)
-		{
-			CoolFilterDirectory(&node, CoolIsAudioFile, DF_ALL);
-		}
-		else if (dirPlayAV == DPAV_VIDEO_)
-		{
-			CoolFilterDirectory(&node, CoolIsVideoFile, DF_ALL);
-		}
-		else if (dirPlayAV == DPAV_NOT_DETERMINED_)
-		{
+	char loc_dirName[PATH_MAX];
+	char loc_trackName[PATH_MAX];
+	int loc_dirPlayAV;
+	int idx;
+
+	LOCK_PLAYMUTEX();
+	strcpy(loc_dirName, dirName);
+	loc_dirPlayAV = dirPlayAV;
+	//DBGMSG("dirPlayAV = [%d]", dirPlayAV);
+	if (dirPlayAV == DPAV_NOT_DETERMINED_) dirPlayAV = DPAV_VIDEO_;
+	UNLOCK_PLAYMUTEX();
+
+	if (loc_dirPlayAV == DPAV_AUDIO_) 
+		listDir(loc_dirName, DPAV_AUDIO_, CoolIsAudioFile);
 #ifdef PLAY_VIDEO_FILE_ONLY
-			CoolFilterDirectory(&node, CoolIsVideoFile, DF_ALL);
-			dirPlayAV = DPAV_VIDEO_;
+	else 
+		listDir(loc_dirName, DPAV_VIDEO_, CoolIsVideoFile);
 #else
-			if (0 == CoolFilterDirectory(&node, CoolIsVideoFile, DF_ALL))
-			{
-				CoolFilterDirectory(&node, CoolIsAudioFile, DF_ALL);
-				dirPlayAV = DPAV_AUDIO_;
-			}
-			else dirPlayAV = DPAV_VIDEO_;
-#endif
-		}
+	else if ((0 == listDir(loc_dirName, DPAV_VIDEO_, CoolIsVideoFile)) && 
+			 (loc_dirPlayAV == DPAV_NOT_DETERMINED_))
+	{
+		LOCK_PLAYMUTEX();
+		dirPlayAV = DPAV_AUDIO_;
+		UNLOCK_PLAYMUTEX();
+
+		listReset(loc_dirName);
+		listDir(loc_dirName, DPAV_AUDIO_, CoolIsAudioFile);
 	}
+#endif
 
-	// if is playing, get index of currently playback file
-	totalFiles = node.fdnum+node.ffnum;
+	LOCK_PLAYMUTEX();
+	loc_trackName[0] = 0;
+	if (playing && !trackListed) strcpy(loc_trackName, trackName);
+	UNLOCK_PLAYMUTEX();
 
-	if (playing)
-	{
-		int fi;
-		char path[PATH_MAX];
-		
-		fileIdx = 0;
-		fi = totalFiles;
+	idx = loc_trackName[0]? listFind(loc_trackName) : -1;
 
-		while(fi--)
-		{
-			if (!strcmp(trackName,CoolCatFilename2Path(path, PATH_MAX, D_PATH, D_NAME(F_INDEX(fi)))))
-			{
-				//DBGMSG("fi = %d", fi);
-				fileIdx = fi;
-				break;
-			}
-			//DBGMSG("fname = [%s]", trackName);
-			//DBGMSG("path = [%s]", path);
-		}
+	LOCK_PLAYMUTEX();
+	totalFiles = dirTree? TreeCount() : DirListCount();
+	if (playing && !trackListed)
+	{
+		fileIdx = (idx >= 0)? idx : 0;
+		trackListed = 1;
 	}
 	
 	// done with directory init, broadcast.
 	DBGMSG("done with directory initialization.");
 	dirInited = 1;
+	dirListed = 1;
 	UNLOCK_PLAYMUTEX();
 
 	pthread_cond_broadcast(&playdirCond);
-	pthread_exit(NULL);
+	return NULL;
 }
 
 static char * nextFileFromDir(int idx,char * pathbuf,const int bufsize)
 {
-	char * fname = NULL;
+	int loc_playtype;
 
 	LOCK_PLAYMUTEX();
-	if ((idx < totalFiles) && (idx >= 0))
-	{
-		//fetch filename based on index.
-		fname = CoolCatFilename2Path(pathbuf, bufsize, D_PATH, D_NAME(F_INDEX(idx)));
-		fname = pathbuf;
-		//DBGMSG("file name = [%s]", fname);
-	}
+	loc_playtype = playtype;
 	UNLOCK_PLAYMUTEX();
-	return fname;
+
+	// playlist entries are read from disk, directory entries may still 
+	// be on their way, keep both out of the lock.
+	if (loc_playtype == NPT_PLAYLIST)
+		return PlaylistGetEntry(idx, pathbuf, bufsize);
+	return listGet(idx, pathbuf, bufsize, 1);
 }
 
-static int getNewIndex()
+// remember where a file was left. Entries of a playlist are recorded
+// as plain files, only the playlist itself is recorded as NPT_PLAYLIST.
+static void saveBookmark(int type, int idx, int mark, const char * file)
+{
+	SetPlayHistory((type == NPT_PLAYLIST)? NPT_FILE : type, idx, mark, file);
+}
+
+static int pickIndex()
 {
 	int newindex;
 
@@ -1046,7 +1321,25 @@ static int getNewIndex()
 	
 	if (repeat == RM_SHUFFLE) // repeat once
 	{
-		newindex = rand()%totalFiles;
+		// order is a permutation of a fixed count, wait for the walk.
+		while (!dirListed && going)
+			pthread_cond_wait(&playdirCond, &playMutex);
+		if (!dirListed)
+		{
+			newindex = -1;
+			goto bail;
+		}
+
+		if (trackChange == TC_PREVIOUS)
+		{
+			newindex = ShufflePrev(totalFiles);
+			if (newindex < 0) newindex = fileIdx;
+		}
+		else
+		{
+			ShuffleSeen(fileIdx);
+			newindex = ShuffleNext(totalFiles);
+		}
 		goto bail;
 	}
 	
@@ -1087,21 +1380,48 @@ static int getNewIndex()
 	return newindex;
 }
 
+static int getNewIndex()
+{
+	char path[PATH_MAX];
+	char * fname;
+	int newindex;
+	int tries;
+
+	LOCK_PLAYMUTEX();
+	tries = (repeat == RM_REPEAT)? 1 : totalFiles;
+	UNLOCK_PLAYMUTEX();
+
+	// step over files known to be unplayable, as if each had failed.
+	while (1)
+	{
+		newindex = pickIndex();
+		if ((newindex < 0) || (--tries <= 0)) break;
+
+		fname = nextFileFromDir(newindex, path, PATH_MAX);
+		if (!fname || !BadFileCheck(fname)) break;
+
+		LOCK_PLAYMUTEX();
+		fileIdx = newindex;
+		UNLOCK_PLAYMUTEX();
+	}
+
+	return newindex;
+}
+
 // thread to automatically fetch next file to play.
 static void * nextFileLoop(void * arg)
 {
     char * fname = NULL;
 	char path[PATH_MAX];
+	struct timeval changeStart;
  	
 	// wait till directory is initialized.
 	LOCK_PLAYMUTEX();
-	while (!dirInited) 
+	while (!dirInited && going) 
 		pthread_cond_wait(&playdirCond, &playMutex);
 	firstplay = fileIdx;
 	UNLOCK_PLAYMUTEX();
 
-	srand((int)time(0));
-
 	while(1)
 	{
 		LOCK_PLAYMUTEX();
@@ -1130,6 +1450,30 @@ static void * nextFileLoop(void * arg)
 			break;
 		}		
 
+		{
+			// leaving a track half way, remember where.
+			char loc_curFile[PATH_MAX];
+			int loc_mark = 0;
+			int loc_idx = 0;
+			int loc_playtype = 0;
+
+			loc_curFile[0] = 0;
+			gettimeofday(&changeStart, NULL);
+			LOCK_PLAYMUTEX();
+			// a client asking waits from the request on.
+			if (trackChange == TC_NEXT || trackChange == TC_PREVIOUS)
+				changeStart = changeAsked;
+			if (playing && (trackChange == TC_NEXT || trackChange == TC_PREVIOUS))
+			{
+				strcpy(loc_curFile, curFile);
+				loc_mark = playtime;
+				loc_idx = fileIdx;
+				loc_playtype = playtype;
+			}
+			UNLOCK_PLAYMUTEX();
+			if (loc_curFile[0]) saveBookmark(loc_playtype, loc_idx, loc_mark, loc_curFile);
+		}
+
 		LOCK_PLAYMUTEX();
 		fileIdx = index;
 		UNLOCK_PLAYMUTEX();
@@ -1139,13 +1483,20 @@ static void * nextFileLoop(void * arg)
 		if (fname)
 		{
 			int ret;
+
 			stopPlaying();
+			noteStopLatency(&changeStart, "track change");
 			ret = playFile(fname);
 			if (ret == 0)
 			{
+				int loc_playtype;
+
 				LOCK_PLAYMUTEX();
 				trackChange = TC_DISABLE;
+				loc_playtype = playtype;
 				UNLOCK_PLAYMUTEX();
+
+				if (loc_playtype == NPT_PLAYLIST) PlaylistPrefetch(index);
 			}
 			else if (ret == 1) break; //if we get locked output, no point in keeping trying other files
 
@@ -1164,7 +1515,7 @@ static void * nextFileLoop(void * arg)
 	UNLOCK_PLAYMUTEX();
 	
 	
-	pthread_exit(NULL);
+	return NULL;
 }
 
 /**
@@ -1226,19 +1577,30 @@ SrvPlayDir( const char * dir )
 	char loc_dirName[PATH_MAX];
 	int isDir = 0;
 	int loc_repeat;
+	unsigned int seed = 0;
+	int spos = 0;
 	
 	DBGMSG("play directory: [%s]", dir);
 	stopServer();
 
 	strcpy(loc_dirName, dir);
+	// resume shuffle order if dir was left from history.
+	if (GetPlayShuffle(dir, &seed, &spos)) seed = 0;
 
 	LOCK_PLAYMUTEX();
+	ShuffleReset(seed, spos);
 	strcpy(dirName, dir);
 	strcpy(trackName, dir);
 	everPlayed = 0;
 	dirInited = 0;
+	dirListed = 0;
+	trackListed = 0;
+	dirTree = (playmode == PM_TREE);
 	going = 1;
 	fileCnt = 1;
+	fileIdx = 0;
+	totalFiles = 0;
+	scannedFiles = 0;
 	playtype = NPT_DIR;
 	dirPlayAV = DPAV_NOT_DETERMINED_;
 	UNLOCK_PLAYMUTEX();
@@ -1304,15 +1666,16 @@ SrvPlayDir( const char * dir )
 		UNLOCK_PLAYMUTEX();
 		return -1;
 	}
+	listReset(loc_dirName);
 
-	if (newThread(&nextFileThread, NULL, nextFileLoop, NULL))
+	if (EngineSubmit(ENGINE_NEXT_FILE, nextFileLoop, NULL))
 	{
 		return -1;
 	}
 
 	//DBGMSG("create directory init thread", dir);
 	// Create thread to init directory.
-	if (newThread(&dirInitThread, NULL, dirInit, NULL))
+	if (EngineSubmit(ENGINE_DIR_INIT, dirInit, NULL))
 	{
 		stopServer();
 		return -1;
@@ -1331,30 +1694,30 @@ SrvPlayDir( const char * dir )
 		// not single repeat or trackName is directory, wait to get first file played 
 		if (loc_repeat != RM_REPEAT || isDir) 
 		{
-			int cnt; // counter of retry
 			int idx = 0;
 
 			//DBGMSG("playback not started yet", dir);
-			// NO, wait till directory is initialized.
+			// NO, wait till first entries are listed.
 			LOCK_PLAYMUTEX();
-			while (!dirInited) 
+			while (!dirInited && going) 
 				pthread_cond_wait(&playdirCond, &playMutex);
 			
 			// Now try to get next file and play it.
 			fileIdx = 0;
-			cnt = totalFiles;
 			UNLOCK_PLAYMUTEX();
 
-			// try each file at most once.
-			while(cnt--)
+			// try each file at most once, the rest of directory is 
+			// still being listed meanwhile.
+			while(1)
 			{
 				fname = nextFileFromDir(idx,path,PATH_MAX);
 				if (!fname) break;
 				
-				status = playFile(fname);
+				if (BadFileCheck(fname)) status = -1;
+				else status = playFile(fname);
 				
 				//DBGMSG("status = [%d]", status);
-				if (!status) break;
+				if (!status || playCancelled()) break;
 				else
 				{
 					LOCK_PLAYMUTEX();
@@ -1363,7 +1726,7 @@ SrvPlayDir( const char * dir )
 					UNLOCK_PLAYMUTEX();
 				}
 			} 
-			if (cnt <= 0)
+			if (status)
 			{
 				LOCK_PLAYMUTEX();
 				errorStatus = NMS_STATUS_NOT_PLAYABLE;
@@ -1385,6 +1748,100 @@ SrvPlayDir( const char * dir )
 	return status;
 }
 
+static int playList( const char * list, int first )
+{
+	int status = -1;
+	int cnt;
+	int idx;
+	char path[PATH_MAX];
+	unsigned int seed = 0;
+	int spos = 0;
+
+	DBGMSG("play list: [%s]", list);
+	stopServer();
+
+	cnt = PlaylistOpen(list);
+	if (cnt <= 0)
+	{
+		LOCK_PLAYMUTEX();		
+		errorStatus = NMS_STATUS_NOT_PLAYABLE;
+		UNLOCK_PLAYMUTEX();
+		PlaylistClose();
+		return -1;
+	}
+	if ((first < 0) || (first >= cnt)) first = 0;
+	if (GetPlayShuffle(list, &seed, &spos)) seed = 0;
+
+	LOCK_PLAYMUTEX();
+	ShuffleReset(seed, spos);
+	strcpy(dirName, list);
+	strcpy(trackName, list);
+	everPlayed = 0;
+	going = 1;
+	fileCnt = 1;
+	playtype = NPT_PLAYLIST;
+	totalFiles = cnt;
+	fileIdx = first;
+	// nothing to scan, entries are resolved on demand.
+	dirInited = 1;
+	dirListed = 1;
+	UNLOCK_PLAYMUTEX();
+
+	if (EngineSubmit(ENGINE_NEXT_FILE, nextFileLoop, NULL))
+	{
+		stopServer();
+		return -1;
+	}
+
+	// try each entry at most once, starting from the requested one.
+	for (idx = first; cnt--; idx = (idx + 1) % totalFiles)
+	{
+		if (!nextFileFromDir(idx, path, PATH_MAX)) break;
+
+		LOCK_PLAYMUTEX();
+		fileIdx = idx;
+		UNLOCK_PLAYMUTEX();
+
+		status = playFile(path);
+		if (!status || (status == 1) || playCancelled()) break;
+	}
+
+	if (status)
+	{
+		LOCK_PLAYMUTEX();
+		if (status != 1) errorStatus = NMS_STATUS_NOT_PLAYABLE;
+		UNLOCK_PLAYMUTEX();
+		stopServer();
+	}
+	else
+	{
+		LOCK_PLAYMUTEX();
+		playState = NMS_STATUS_PLAYER_PLAY; 
+		errorStatus = NMS_STATUS_OK;
+		UNLOCK_PLAYMUTEX();
+		PlaylistPrefetch(idx);
+	}
+
+	return status;
+}
+
+/**
+ * Play back specified playlist (M3U or PLS).
+ * Entries are played in order, track change, repeat and shuffle 
+ * behave the same as in directory playback.
+ *
+ * @param list
+ *        playlist path.
+ * @return
+ *        0 if playlist playback started, in other words, at least one
+ *        entry is playable, otherwise nonzero.
+ *        1 if output was locked when trying to play.
+ */
+int
+SrvPlayList( const char * list )
+{
+	return playList(list, 0);
+}
 
 /** play history .*/
 int SrvPlayHistory(void)
@@ -1411,6 +1868,7 @@ int SrvPlayHistory(void)
 		{
 		case NPT_FILE: status = SrvPlayFile(his.path); break;
 		case NPT_DIR:  status = SrvPlayDir(his.path); break;
+		case NPT_PLAYLIST: status = playList(his.path, his.fileIdx); break;
 		default: break;
 		}
 	}
@@ -1420,7 +1878,9 @@ int SrvPlayHistory(void)
 		//DBGMSG("playing history data-type:[%d] idx:[%d]"
 		//"mark: [%d] path:[%s]", 
 		//his.type, his.fileIdx, his.mark, his.path); 
+#ifndef RESUME_FROM_BOOKMARK
 		SrvSeek(his.mark);
+#endif
 	}
 	else
 		// No history available, or history is unplayable
@@ -1492,11 +1952,15 @@ SrvPauseUnpause( void )
 void
 SrvStop( void )
 {
+	struct timeval start;
 	int loc_going;
 	int loc_fileIdx;
 	int loc_everPlayed;
 	int loc_playtype;
+	int inited;
 
+	// latency is what the client waits, bookmark included.
+	gettimeofday(&start, NULL);
 	LOCK_PLAYMUTEX();
 	loc_going = going;
 	loc_fileIdx = fileIdx;
@@ -1518,6 +1982,13 @@ SrvStop( void )
 			UNLOCK_PLAYMUTEX();
 			break;
 		case NPT_DIR:
+			// never wait for the listing, nothing to mark till published.
+			LOCK_PLAYMUTEX();
+			inited = dirInited;
+			UNLOCK_PLAYMUTEX();
+			if (inited) path = listGet(loc_fileIdx,buf,PATH_MAX,0);
+			break;
+		case NPT_PLAYLIST:
 			path = nextFileFromDir(loc_fileIdx,buf,PATH_MAX); break;
 		default: //history not supported.
 			WPRINT("play history not supported.");
@@ -1532,16 +2003,34 @@ SrvStop( void )
 		if (path)
 		{
 			int mark;
+			unsigned int seed;
+			int spos;
 
 			LOCK_PLAYMUTEX();			
 			mark = playtime;
+			ShuffleGetState(&seed, &spos);
 			UNLOCK_PLAYMUTEX();
 
-			if (loc_everPlayed) SetPlayHistory(loc_playtype, loc_fileIdx, mark, path);
+			if (loc_everPlayed)
+			{
+				saveBookmark(loc_playtype, loc_fileIdx, mark, path);
+
+				// playlist goes last, it is what history plays back.
+				if (loc_playtype == NPT_PLAYLIST)
+				{
+					LOCK_PLAYMUTEX();
+					strcpy(buf, trackName);
+					UNLOCK_PLAYMUTEX();
+					SetPlayHistory(NPT_PLAYLIST, loc_fileIdx, mark, buf);
+				}
+				// keep shuffle order with the entry history resumes.
+				if (loc_playtype != NPT_FILE)
+					SetPlayShuffle((loc_playtype == NPT_PLAYLIST)? buf : path, seed, spos);
+			}
 		}
 	}	
 
-	stopServer();
+	stopServerSince(&start);
 
 	LOCK_PLAYMUTEX();
 	// player has been stop upon user request.
@@ -1764,14 +2253,17 @@ SrvTrackChange( int track )
 		if (loc_playing) SrvSeek(0);
 		else return	SrvPlayFile(loc_trackName);
 	}
-	else if (NPT_DIR == loc_playtype)
+	else if ((NPT_DIR == loc_playtype) || (NPT_PLAYLIST == loc_playtype))
 	{
-		if (!loc_going) return SrvPlayDir(loc_trackName);
+		if (!loc_going) 
+			return (NPT_DIR == loc_playtype)? 
+				SrvPlayDir(loc_trackName) : SrvPlayList(loc_trackName);
 		switch (track)
 		{
 		case 1:
 			LOCK_PLAYMUTEX();	
 			trackChange = TC_NEXT;
+			gettimeofday(&changeAsked, NULL);
 			UNLOCK_PLAYMUTEX();
 			pthread_cond_broadcast(&nextFileCond);
 			break;
@@ -1792,6 +2284,7 @@ SrvTrackChange( int track )
 			{
 				LOCK_PLAYMUTEX();
 				trackChange = TC_PREVIOUS;
+				gettimeofday(&changeAsked, NULL);
 				UNLOCK_PLAYMUTEX();
 				pthread_cond_broadcast(&nextFileCond);
 			}
@@ -1861,6 +2354,12 @@ int
 SrvGetMediaInfo(const char *filename, void * minfo )
 {
 	int rlt;
+	struct stat st;
+	int cacheable;
+
+	// served from cache without waiting for playback.
+	cacheable = !stat(filename, &st) && S_ISREG(st.st_mode);
+	if (cacheable && !MediaCacheLookup(filename, &st, minfo)) return 0;
 
 	// is our format, info always available.
 	((media_info_t *)minfo)->available = 1;
@@ -1869,9 +2368,51 @@ SrvGetMediaInfo(const char *filename, void * minfo )
 	rlt = InputGetInfo( filename, minfo );
 	UNLOCK_PLAYMUTEX();
 
+	if (cacheable && !rlt) MediaCacheStore(filename, &st, minfo);
+
 	return rlt;	
 }
 
+/**
+ * Get media info cache statistics.
+ *
+ * @param stats
+ *        statistics buffer.
+ */
+void
+SrvGetMediaCacheStats( media_cache_stats_t * stats )
+{
+	MediaCacheGetStats(stats);
+}
+
+
+/**
+ * Get unplayable file cache statistics.
+ *
+ * @param stats
+ *        statistics buffer.
+ */
+void
+SrvGetBadFileStats( bad_file_stats_t * stats )
+{
+	BadFileGetStats(stats);
+}
+
+/**
+ * Get latency of stopping playback, either on STOP or on track change,
+ * counted from the request as the client waits.
+ *
+ * @param stats
+ *        statistics buffer.
+ */
+void
+SrvGetStopLatencyStats( stop_latency_stats_t * stats )
+{
+	LOCK_PLAYMUTEX();
+	memcpy(stats, &stopStats, sizeof(stop_latency_stats_t));
+	UNLOCK_PLAYMUTEX();
+}
+
 
 /**
  * Tell if server is playing.
@@ -1992,7 +2533,8 @@ SrvSetRepeatmode( int mode )
 }
 
 /**
- * Get total playable files.
+ * Get total playable files, files read so far while a directory listing
+ * is not published yet.
  *
  */
 int    
@@ -2001,7 +2543,7 @@ SrvGetTotalFiles(void)
 	int loc_totalFiles;
 
 	LOCK_PLAYMUTEX();
-	loc_totalFiles = totalFiles;
+	loc_totalFiles = totalFiles? totalFiles : scannedFiles;
 	UNLOCK_PLAYMUTEX();
 
     return loc_totalFiles;
@@ -2029,6 +2571,7 @@ SrvGetFileIndex(void)
 		{
 		case NPT_FILE: idx = 0; break;
 		case NPT_DIR: 
+		case NPT_PLAYLIST: 
 			{
 				LOCK_PLAYMUTEX();				
 				if (dirInited) idx = fileIdx;
@@ -2071,11 +2614,20 @@ SrvGetFilePath(int idx, void * pathbuf,const int bufsize)
 			UNLOCK_PLAYMUTEX();
 			ret = 0;
 		}
-		else if (loc_playtype == NPT_DIR)
+		else if ((loc_playtype == NPT_DIR) || (loc_playtype == NPT_PLAYLIST))
 		{
-			if (idx >= 0)
+			int inited;
+
+			LOCK_PLAYMUTEX();
+			inited = dirInited;
+			UNLOCK_PLAYMUTEX();
+
+			// no index is valid till the listing is published.
+			if ((idx >= 0) && ((loc_playtype != NPT_DIR) || inited))
 			{
-				nextFileFromDir(idx,pc,bufsize);
+				// do not wait for entries not listed yet.
+				if (loc_playtype == NPT_DIR) listGet(idx,pc,bufsize,0);
+				else nextFileFromDir(idx,pc,bufsize);
 				//DBGMSG("filepath = [%s]", path);
 				ret = 0;
 			}
@@ -0,0 +1,276 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms playlist module.
+ *
+ * M3U and PLS playlists are never loaded whole. Opening a playlist makes
+ * a single streaming pass that counts entries and remembers the file 
+ * offset of every PLAYLIST_CHECKPOINT'th entry, an entry is then read
+ * back from disk and resolved to a full path only when it is asked for.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-playlist.h"
+
+#define LINE_MAX_  (PATH_MAX + 32)
+
+static pthread_mutex_t    listMutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *             listFile;
+static int                isPls;
+static char               listDir[PATH_MAX];
+static int                total;
+static long *             checkpoints;
+static int                cursorIdx = -1; // entry last read
+static long               cursorOff;      // file offset right after it
+
+/*
+ * Extract the entry carried by a playlist line, if any.
+ * Returns pointer into line, NULL for comments and other lines.
+ */
+static char * lineEntry( char * line )
+{
+	char * p;
+	char * e;
+
+	for (p = line; isspace((unsigned char)*p); p++);
+	e = p + strlen(p);
+	while ((e > p) && isspace((unsigned char)e[-1])) *--e = 0;
+	if (!*p) return NULL;
+
+	if (isPls)
+	{
+		// FileN=path, anything else is meta data.
+		if (strncasecmp(p, "File", 4)) return NULL;
+		for (p += 4; isdigit((unsigned char)*p); p++);
+		if (*p++ != '=') return NULL;
+		return *p? p : NULL;
+	}
+
+	return (*p == '#')? NULL : p;
+}
+
+static int nextEntry( char * line, int size, char ** entry )
+{
+	while (fgets(line, size, listFile))
+	{
+		if ((*entry = lineEntry(line)) != NULL) return 0;
+	}
+	return -1;
+}
+
+/**
+ * Open a playlist for playback.
+ *
+ * @param path
+ *        playlist path, PLS if extension says so, M3U otherwise.
+ * @return
+ *        number of entries, negative if playlist can not be read.
+ */
+int
+PlaylistOpen( const char * path )
+{
+	char line[LINE_MAX_];
+	char * entry;
+	char * ext;
+	long off;
+	int ret;
+
+	PlaylistClose();
+
+	pthread_mutex_lock(&listMutex);
+	listFile = fopen(path, "r");
+	if (!listFile)
+	{
+		WPRINT("unable to open playlist.");
+		ret = -1;
+		goto bail;
+	}
+
+	ext = strrchr(path, '.');
+	isPls = (ext && !strcasecmp(ext, ".pls"));
+
+	strncpy(listDir, path, PATH_MAX - 1);
+	listDir[PATH_MAX - 1] = 0;
+	ext = strrchr(listDir, '/');
+	if (ext) *ext = 0;
+	else strcpy(listDir, ".");
+
+	// one streaming pass: count entries, remember sparse offsets.
+	total = 0;
+	off = 0;
+	while (!nextEntry(line, sizeof(line), &entry))
+	{
+		if (0 == (total % PLAYLIST_CHECKPOINT))
+		{
+			long * p = realloc(checkpoints, (total / PLAYLIST_CHECKPOINT + 1) * sizeof(long));
+			if (!p) break;
+			checkpoints = p;
+			checkpoints[total / PLAYLIST_CHECKPOINT] = off;
+		}
+		total++;
+		off = ftell(listFile);
+	}
+	DBGLOG("playlist opened, %d entries.", total);
+	ret = total;
+
+ bail:
+	pthread_mutex_unlock(&listMutex);
+	return ret;
+}
+
+/**
+ * Close current playlist.
+ */
+void
+PlaylistClose( void )
+{
+	pthread_mutex_lock(&listMutex);
+	if (listFile) fclose(listFile);
+	listFile = NULL;
+	free(checkpoints);
+	checkpoints = NULL;
+	total = 0;
+	cursorIdx = -1;
+	pthread_mutex_unlock(&listMutex);
+}
+
+/**
+ * @return
+ *        number of entries in current playlist.
+ */
+int
+PlaylistGetTotal( void )
+{
+	int loc_total;
+
+	pthread_mutex_lock(&listMutex);
+	loc_total = total;
+	pthread_mutex_unlock(&listMutex);
+
+	return loc_total;
+}
+
+/**
+ * Fetch playlist entry, resolved to full path.
+ *
+ * @param idx
+ *        entry index, starting from 0.
+ * @param pathbuf
+ *        path buffer.
+ * @param bufsize
+ *        path buffer size.
+ * @return
+ *        pathbuf if entry is available, NULL otherwise.
+ */
+char *
+PlaylistGetEntry( int idx, char * pathbuf, const int bufsize )
+{
+	char line[LINE_MAX_];
+	char * entry = NULL;
+	char * p;
+	int cur;
+
+	pthread_mutex_lock(&listMutex);
+	if (!listFile || (idx < 0) || (idx >= total)) goto bail;
+
+	// sequential access continues from the cursor, others from a checkpoint.
+	if ((cursorIdx >= 0) && (idx > cursorIdx) && 
+		(idx - cursorIdx <= PLAYLIST_CHECKPOINT))
+	{
+		fseek(listFile, cursorOff, SEEK_SET);
+		cur = cursorIdx + 1;
+	}
+	else
+	{
+		fseek(listFile, checkpoints[idx / PLAYLIST_CHECKPOINT], SEEK_SET);
+		cur = idx - (idx % PLAYLIST_CHECKPOINT);
+	}
+
+	for (; cur <= idx; cur++)
+	{
+		if (nextEntry(line, sizeof(line), &entry))
+		{
+			// playlist changed underneath us.
+			entry = NULL;
+			cursorIdx = -1;
+			goto bail;
+		}
+	}
+	cursorIdx = idx;
+	cursorOff = ftell(listFile);
+
+	if (!strncmp(entry, "file://", 7)) entry += 7;
+	for (p = entry; *p; p++) if (*p == '\\') *p = '/';
+
+	if (entry[0] == '/')
+		snprintf(pathbuf, bufsize, "%s", entry);
+	else
+		snprintf(pathbuf, bufsize, "%s/%s", listDir, entry);
+
+ bail:
+	pthread_mutex_unlock(&listMutex);
+	return entry? pathbuf : NULL;
+}
+
+/**
+ * Warm up the entries following the one being played, so that probing 
+ * and starting them does not wait on the disk.
+ *
+ * @param idx
+ *        index of entry being played.
+ */
+void
+PlaylistPrefetch( int idx )
+{
+	char path[PATH_MAX];
+	struct stat st;
+	int ii;
+	int fd;
+
+	for (ii = 1; ii <= PLAYLIST_PREFETCH; ii++)
+	{
+		if (!PlaylistGetEntry(idx + ii, path, PATH_MAX)) break;
+		if (stat(path, &st) || !S_ISREG(st.st_mode)) continue;
+
+		fd = open(path, O_RDONLY);
+		if (fd < 0) continue;
+		posix_fadvise(fd, 0, PLAYLIST_READAHEAD, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
@@ -0,0 +1,326 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms batch media probe.
+ *
+ * A small pool of persistent workers parses media info for a list of
+ * files, or all files of a directory, and streams the result of each file 
+ * back to the client as soon as it is ready. Workers never take playMutex;
+ * input plugins are not reentrant, the plugin layer serializes probing 
+ * and parsing with playback setting up its own file. While playing, 
+ * workers pause between files so they stay out of the way of playback I/O.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "cmd-nms.h"
+#include "com-nms.h"
+#include "server-nms.h"
+#include "plugin-internals.h"
+#include "server-media-cache.h"
+#include "server-probe.h"
+
+typedef struct probe_batch
+{
+	struct probe_batch * next;
+	int                  fd;        // client connection, owned by batch.
+	char **              paths;
+	char *               strings;   // storage for paths.
+	int                  total;
+	int                  issued;    // files handed to workers.
+	int                  done;      // files completed.
+	int                  broken;    // client went away.
+	pthread_mutex_t      sendMutex;
+} probe_batch_t;
+
+static pthread_mutex_t    probeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     probeCond = PTHREAD_COND_INITIALIZER;
+static probe_batch_t *    queueHead;
+static probe_batch_t *    queueTail;
+static int                workers;
+
+#define LOCK_PROBEMUTEX()   pthread_mutex_lock(&probeMutex)
+#define UNLOCK_PROBEMUTEX() pthread_mutex_unlock(&probeMutex)
+
+static void freeBatch( probe_batch_t * b )
+{
+	pthread_mutex_destroy(&b->sendMutex);
+	free(b->paths);
+	free(b->strings);
+	free(b);
+}
+
+static int probeFile( const char * path, media_info_t * minfo )
+{
+	struct stat st;
+	int cacheable;
+	int rlt;
+
+	memset(minfo, 0, sizeof(media_info_t));
+	cacheable = !stat(path, &st) && S_ISREG(st.st_mode);
+	if (cacheable && !MediaCacheLookup(path, &st, minfo)) return 0;
+
+	// is our format, info always available.
+	minfo->available = 1;
+	rlt = InputGetInfo(path, minfo);
+
+	if (cacheable && !rlt) MediaCacheStore(path, &st, minfo);
+	return rlt;
+}
+
+static void sendResult( probe_batch_t * b, const char * path, int status, 
+						const media_info_t * minfo )
+{
+	char pkt[sizeof(media_probe_result_t) + PATH_MAX];
+	media_probe_result_t * r = (media_probe_result_t *)pkt;
+	int len;
+
+	r->status = status;
+	memcpy(&r->info, minfo, sizeof(media_info_t));
+	len = strlen(path) + 1;
+	if (len > PATH_MAX) len = PATH_MAX;
+	memcpy(pkt + sizeof(media_probe_result_t), path, len);
+	pkt[sizeof(media_probe_result_t) + len - 1] = 0;
+
+	pthread_mutex_lock(&b->sendMutex);
+	if (!b->broken && 
+		(CoolCmdSendPacket(b->fd, CMD_MEDIA_INFO_BATCH|NMS_CMD_ACK, 
+						   pkt, sizeof(media_probe_result_t) + len) < 0))
+	{
+		WPRINT("probe client went away.");
+		b->broken = 1;
+	}
+	pthread_mutex_unlock(&b->sendMutex);
+}
+
+static void * probeLoop( void * arg )
+{
+	probe_batch_t * b;
+	media_info_t minfo;
+	const char * path;
+	int status;
+	int last;
+
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), PROBE_NICE);
+
+	while (1)
+	{
+		LOCK_PROBEMUTEX();
+		while (!queueHead) pthread_cond_wait(&probeCond, &probeMutex);
+
+		b = queueHead;
+		path = b->paths[b->issued++];
+		// all files handed out, the batch stays alive until done.
+		if (b->issued == b->total)
+		{
+			queueHead = b->next;
+			if (!queueHead) queueTail = NULL;
+		}
+		UNLOCK_PROBEMUTEX();
+
+		if (b->broken) status = -1;
+		else
+		{
+			if (SrvIsPlaying()) usleep(PROBE_YIELD_TICK);
+			status = probeFile(path, &minfo);
+			sendResult(b, path, status, &minfo);
+		}
+
+		LOCK_PROBEMUTEX();
+		last = (++b->done == b->total);
+		UNLOCK_PROBEMUTEX();
+
+		if (last)
+		{
+			// empty packet terminates the batch.
+			if (!b->broken) 
+				CoolCmdSendPacket(b->fd, CMD_MEDIA_INFO_BATCH|NMS_CMD_ACK, NULL, 0);
+			close(b->fd);
+			DBGLOG("probe batch of %d files completed.", b->total);
+			freeBatch(b);
+		}
+	}
+
+	return NULL;
+}
+
+static int startWorkers( void )
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	if (workers) return 0;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (; workers < PROBE_WORKERS; workers++)
+	{
+		if (pthread_create(&thread, &attr, probeLoop, NULL)) break;
+	}
+	pthread_attr_destroy(&attr);
+
+	if (!workers) 
+	{
+		WPRINT("unable to create probe workers.");
+		return -1;
+	}
+	return 0;
+}
+
+static void listDirectory( probe_batch_t * b, const char * dir )
+{
+	DIR * dp;
+	struct dirent * de;
+	struct stat st;
+	char path[PATH_MAX];
+	int size = 0;
+	int used = 0;
+	int n = 0;
+	int len;
+	char * s;
+
+	dp = opendir(dir);
+	if (!dp) return;
+
+	while ((de = readdir(dp)))
+	{
+		if (de->d_name[0] == '.') continue;
+		snprintf(path, PATH_MAX, "%s/%s", dir, de->d_name);
+		if ((de->d_type != DT_REG) &&
+			((de->d_type != DT_UNKNOWN) || stat(path, &st) || !S_ISREG(st.st_mode)))
+			continue;
+
+		len = strlen(path) + 1;
+		if (used + len > size)
+		{
+			size = (size + len) * 2;
+			s = realloc(b->strings, size);
+			if (!s) break;
+			b->strings = s;
+		}
+		memcpy(b->strings + used, path, len);
+		used += len;
+		n++;
+	}
+	closedir(dp);
+
+	b->total = n;
+}
+
+/**
+ * Start probing a batch of files.
+ *
+ * Results are sent back on the given connection, one packet per file as 
+ * each completes, in no particular order. An empty packet ends the batch.
+ * Connection is owned and closed by the probe module on success.
+ *
+ * @param fd
+ *        client connection.
+ * @param data
+ *        NUL separated list of file paths, or a single directory path.
+ * @param len
+ *        data length.
+ * @return
+ *        0 if batch is queued, otherwise -1.
+ */
+int
+ProbeBatchStart( int fd, const char * data, int len )
+{
+	probe_batch_t * b;
+	struct stat st;
+	const char * s;
+	int ii;
+
+	if (!data || (len <= 0)) return -1;
+
+	b = calloc(1, sizeof(probe_batch_t));
+	if (!b) return -1;
+	b->fd = fd;
+	pthread_mutex_init(&b->sendMutex, NULL);
+
+	b->strings = malloc(len + 1);
+	if (!b->strings) goto bail;
+	memcpy(b->strings, data, len);
+	b->strings[len] = 0;
+
+	if ((strlen(b->strings) + 1 >= len) && !stat(b->strings, &st) && S_ISDIR(st.st_mode))
+	{
+		char dir[PATH_MAX];
+
+		strncpy(dir, b->strings, PATH_MAX - 1);
+		dir[PATH_MAX - 1] = 0;
+		free(b->strings);
+		b->strings = NULL;
+		listDirectory(b, dir);
+	}
+	else
+	{
+		for (s = b->strings; s < b->strings + len; s += strlen(s) + 1)
+		{
+			if (*s) b->total++;
+		}
+	}
+	if (!b->total) goto bail;
+
+	b->paths = malloc(b->total * sizeof(char *));
+	if (!b->paths) goto bail;
+	for (ii = 0, s = b->strings; ii < b->total; s += strlen(s) + 1)
+	{
+		if (*s) b->paths[ii++] = (char *)s;
+	}
+
+	LOCK_PROBEMUTEX();
+	if (startWorkers())
+	{
+		UNLOCK_PROBEMUTEX();
+		goto bail;
+	}
+	if (queueTail) queueTail->next = b;
+	else queueHead = b;
+	queueTail = b;
+	pthread_cond_broadcast(&probeCond);
+	UNLOCK_PROBEMUTEX();
+
+	DBGLOG("probe batch of %d files queued.", b->total);
+	return 0;
+
+ bail:
+	freeBatch(b);
+	return -1;
+}
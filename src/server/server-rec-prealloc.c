@@ -0,0 +1,235 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording space reservation.
+ *
+ * The output plugin grows the recording file a frame at a time, leaving 
+ * the file system to allocate blocks at every write. Instead, disk space 
+ * is reserved ahead of the write position, PREALLOC_SECONDS of recording 
+ * at a time, through a descriptor of our own using fallocate() without 
+ * changing the file size, so the plugin writes into blocks allocated in 
+ * one go. Reservation is sized from the bit rate asked for, then from the
+ * rate seen while committing. What is left beyond the end of the file is 
+ * given back when a file is done. File systems that can not reserve 
+ * space are written as before.
+ *
+ * A recording known in advance has its file created and first chunk 
+ * reserved before it starts, off the recording's own start up.
+ *
+ * REVISION:
+ * 
+ * 2) Reserve ahead of recordings not started yet. -------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "server-rec-prealloc.h"
+
+static pthread_mutex_t    preMutex = PTHREAD_MUTEX_INITIALIZER;
+static int                preFd = -1;
+static unsigned int       rate;        // bytes per second expected.
+static unsigned long long committed;   // bytes committed to this file.
+static unsigned long long reserved;    // file offset reserved up to.
+static unsigned long long lastChunk;   // bytes reserved last time.
+static struct timeval     started;
+
+#define LOCK_PREMUTEX()   pthread_mutex_lock(&preMutex)
+#define UNLOCK_PREMUTEX() pthread_mutex_unlock(&preMutex)
+
+#define FILE_LIMIT  ((unsigned long long)(unsigned int)-1)  // plugin offsets are 32 bits.
+
+// bytes reserved at once, from the rate seen once there is some.
+static unsigned long long chunk( void )
+{
+	struct timeval now;
+	unsigned long long ms;
+	unsigned long long bytes;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - started.tv_sec) * 1000ULL + (now.tv_usec - started.tv_usec) / 1000;
+	if ((ms >= 1000) && committed) rate = committed * 1000 / ms;
+
+	bytes = (unsigned long long)rate * PREALLOC_SECONDS;
+	if (bytes < PREALLOC_MIN) bytes = PREALLOC_MIN;
+	if (bytes > PREALLOC_MAX) bytes = PREALLOC_MAX;
+	return bytes;
+}
+
+// reserve another chunk from offset on, gives up reserving on failure.
+static void reserve( unsigned long long offset )
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+	unsigned long long len = chunk();
+
+	if (offset >= FILE_LIMIT) return;
+	if (offset + len > FILE_LIMIT) len = FILE_LIMIT - offset;
+	if (fallocate(preFd, FALLOC_FL_KEEP_SIZE, offset, len))
+	{
+		WPRINT("space not reserved, writing without: %s", strerror(errno));
+		close(preFd);
+		preFd = -1;
+		return;
+	}
+	reserved = offset + len;
+	lastChunk = len;
+	DBGLOG("reserved up to %llu.", reserved);
+#endif
+}
+
+/**
+ * Start reserving space for a file the plugin has created.
+ *
+ * @param path
+ *        file being recorded.
+ * @param kbps
+ *        bit rate expected, unit: kbit/s
+ */
+void
+PreallocStart( const char * path, unsigned int kbps )
+{
+	PreallocStop();
+
+	LOCK_PREMUTEX();
+#ifdef FALLOC_FL_KEEP_SIZE
+	preFd = open(path, O_WRONLY);
+	if (preFd < 0) WPRINT("unable to open %s to reserve space: %s", path, strerror(errno));
+#endif
+	rate = kbps * 1000 / 8;
+	committed = reserved = lastChunk = 0;
+	gettimeofday(&started, NULL);
+	if (preFd >= 0) reserve(0);
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * Create a file ahead of its recording and reserve its first chunk. A 
+ * file that exists already is left alone.
+ *
+ * @param path
+ *        file to be recorded.
+ * @param kbps
+ *        bit rate expected, unit: kbit/s
+ * @return
+ *        0 if file was created.
+ */
+int
+PreallocWarm( const char * path, unsigned int kbps )
+{
+	unsigned long long len = (unsigned long long)kbps * 1000 / 8 * PREALLOC_SECONDS;
+	int fd;
+
+	if (len < PREALLOC_MIN) len = PREALLOC_MIN;
+	if (len > PREALLOC_MAX) len = PREALLOC_MAX;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) return -1;
+#ifdef FALLOC_FL_KEEP_SIZE
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, len))
+		DBGLOG("space not reserved ahead: %s", strerror(errno));
+#endif
+	close(fd);
+	return 0;
+}
+
+/**
+ * Account a frame committed, reserves more once half of the space 
+ * reserved ahead is used. Call from the thread committing.
+ *
+ * @param bytes
+ *        frame size.
+ */
+void
+PreallocCommitted( unsigned int bytes )
+{
+	struct stat st;
+
+	LOCK_PREMUTEX();
+	committed += bytes;
+	if ((preFd >= 0) && (committed + lastChunk / 2 >= reserved))
+	{
+		// container overhead makes the file a bit larger than committed.
+		if (!fstat(preFd, &st) && ((unsigned long long)st.st_size > committed))
+			committed = st.st_size;
+		reserve((committed > reserved)? committed : reserved);
+	}
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * Give back space reserved beyond the end of the file, once the plugin
+ * has finished it.
+ */
+void
+PreallocStop( void )
+{
+	struct stat st;
+
+	LOCK_PREMUTEX();
+	if (preFd >= 0)
+	{
+		if (!fstat(preFd, &st) && ((unsigned long long)st.st_size < reserved))
+		{
+#ifdef FALLOC_FL_PUNCH_HOLE
+			fallocate(preFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 
+					  st.st_size, reserved - st.st_size);
+#endif
+			if (ftruncate(preFd, st.st_size))
+				WPRINT("unable to trim reserved space: %s", strerror(errno));
+		}
+		close(preFd);
+		preFd = -1;
+	}
+	reserved = committed = 0;
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * @return
+ *        bytes reserved beyond what was committed, still free for the
+ *        recording although the disk counts them used.
+ */
+unsigned long long
+PreallocAhead( void )
+{
+	unsigned long long ahead;
+
+	LOCK_PREMUTEX();
+	ahead = (reserved > committed)? reserved - committed : 0;
+	UNLOCK_PREMUTEX();
+	return ahead;
+}
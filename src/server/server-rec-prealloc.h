@@ -0,0 +1,46 @@
+#ifndef NMS_SERVER_REC_PREALLOC__H
+#define NMS_SERVER_REC_PREALLOC__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording space reservation header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 2) Reserve ahead of recordings not started yet. -------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define PREALLOC_SECONDS     10                  // recording time reserved at once.
+#define PREALLOC_MIN         (1024 * 1024)       // bytes reserved at once, at least.
+#define PREALLOC_MAX         (64 * 1024 * 1024)  // and at most.
+#define PREALLOC_AUDIO_KBPS  256                 // audio allowance, unit: kbit/s
+
+void PreallocStart(const char *, unsigned int);
+int  PreallocWarm(const char *, unsigned int);
+void PreallocCommitted(unsigned int);
+void PreallocStop(void);
+unsigned long long PreallocAhead(void);
+
+#endif /* NMS_SERVER_REC_PREALLOC__H */
@@ -0,0 +1,283 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording pre-roll.
+ *
+ * While the monitor runs, the video frames it takes from encoder input 
+ * are kept, up to the last few seconds and PREROLL_BUDGET bytes, always 
+ * starting at a key frame. A recording started soon after writes them 
+ * first, so it begins before record was hit. The monitor does not take 
+ * audio, pre-roll is video only, and it is used only when the recording 
+ * encodes video as the monitor did.
+ *
+ * Recording restarts encoder input, time stamps start over. Kept frames 
+ * are placed before the recording by when they were taken: the first one
+ * is at 0, and the recording starts as long after the last one as it 
+ * really did.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "nmsplugin.h"
+#include "server-rec-segment.h"
+#include "server-rec-preroll.h"
+
+typedef struct preroll_frame
+{
+	struct preroll_frame * next;
+	media_buf_t            buf;
+	long long              at;     // when taken, mili-seconds.
+	int                    size;   // payload follows.
+} preroll_frame_t;
+
+static pthread_mutex_t    preMutex = PTHREAD_MUTEX_INITIALIZER;
+static int                seconds;     // 0 if off.
+static media_desc_t       desc;        // monitor encoding.
+static preroll_frame_t *  head;
+static preroll_frame_t *  tail;
+static unsigned int       frames;
+static unsigned int       bytes;
+
+#define LOCK_PREMUTEX()   pthread_mutex_lock(&preMutex)
+#define UNLOCK_PREMUTEX() pthread_mutex_unlock(&preMutex)
+
+static long long now_ms( void )
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return now.tv_sec * 1000LL + now.tv_usec / 1000;
+}
+
+static void drop_head( void )
+{
+	preroll_frame_t * f = head;
+
+	head = f->next;
+	if (!head) tail = NULL;
+	frames--;
+	bytes -= f->size;
+	free(f);
+}
+
+static void clear( void )
+{
+	while (head) drop_head();
+}
+
+static int is_key( const preroll_frame_t * f )
+{
+	return SegmentIsKeyFrame(desc.vdesc.video_type, f->buf.vbuf.data, f->size);
+}
+
+/**
+ * Set pre-roll length, frames kept are dropped when turned off.
+ *
+ * @param secs
+ *        seconds kept, 0 for off.
+ */
+void
+PrerollSet( int secs )
+{
+	if (secs < 0) secs = 0;
+	if (secs > PREROLL_MAX_SECONDS) secs = PREROLL_MAX_SECONDS;
+
+	LOCK_PREMUTEX();
+	seconds = secs;
+	if (!seconds) clear();
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * Monitor (re)started encoder input, frames kept so far do not fit.
+ *
+ * @param mdesc
+ *        monitor encoding.
+ */
+void
+PrerollStart( const media_desc_t * mdesc )
+{
+	LOCK_PREMUTEX();
+	clear();
+	memcpy(&desc, mdesc, sizeof(media_desc_t));
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * @return
+ *        nonzero if frames are to be kept.
+ */
+int
+PrerollActive( void )
+{
+	int ret;
+
+	LOCK_PREMUTEX();
+	ret = seconds;
+	UNLOCK_PREMUTEX();
+	return ret;
+}
+
+/**
+ * Keep a video frame the monitor took, older ones go.
+ *
+ * @param buf
+ *        frame as taken from encoder input.
+ */
+void
+PrerollPush( const media_buf_t * buf )
+{
+	preroll_frame_t * f;
+	int size = buf->vbuf.size;
+	long long at = now_ms();
+
+	if ((size <= 0) || (size > PREROLL_BUDGET)) return;
+	f = malloc(sizeof(preroll_frame_t) + size);
+	if (!f) return;
+	memcpy(&f->buf, buf, sizeof(media_buf_t));
+	f->next = NULL;
+	f->at = at;
+	f->size = size;
+	f->buf.curbuf = &f->buf.vbuf;
+	f->buf.vbuf.data = (void *)(f + 1);
+	memcpy(f->buf.vbuf.data, buf->vbuf.data, size);
+
+	LOCK_PREMUTEX();
+	if (!seconds || (!head && !is_key(f)))
+	{
+		// nothing to start from yet.
+		UNLOCK_PREMUTEX();
+		free(f);
+		return;
+	}
+	if (tail) tail->next = f;
+	else head = f;
+	tail = f;
+	frames++;
+	bytes += size;
+
+	// keep it in time and budget, then start at a key frame again.
+	if (head && ((at - head->at > seconds * 1000LL) || (bytes > PREROLL_BUDGET)))
+	{
+		while (head && ((at - head->at > seconds * 1000LL) || (bytes > PREROLL_BUDGET)))
+			drop_head();
+		while (head && !is_key(head))
+			drop_head();
+	}
+	UNLOCK_PREMUTEX();
+}
+
+/**
+ * Hand kept frames over to a recording starting now, they are gone after.
+ *
+ * @param mdesc
+ *        recording encoding.
+ * @param save
+ *        called for each frame in order, time stamp set from 0 on.
+ * @return
+ *        mili-seconds the recording starts at, 0 if nothing was saved.
+ */
+int
+PrerollFlush( const media_desc_t * mdesc, preroll_save_t save )
+{
+	preroll_frame_t * list;
+	preroll_frame_t * last;
+	preroll_frame_t * f;
+	long long start = now_ms();
+	int first;
+	int length = 0;
+
+	LOCK_PREMUTEX();
+	// only what is still within pre-roll length now, from a key frame on.
+	while (head && (start - head->at > seconds * 1000LL))
+		drop_head();
+	while (head && !is_key(head))
+		drop_head();
+	if (head && 
+		((mdesc->vdesc.video_type != desc.vdesc.video_type) ||
+		 (mdesc->vdesc.width != desc.vdesc.width) ||
+		 (mdesc->vdesc.height != desc.vdesc.height) ||
+		 (mdesc->vdesc.frame_rate != desc.vdesc.frame_rate)))
+	{
+		WPRINT("recording encodes video unlike monitor, pre-roll dropped.");
+		clear();
+	}
+	list = head;
+	last = tail;
+	head = tail = NULL;
+	frames = bytes = 0;
+	UNLOCK_PREMUTEX();
+
+	if (list)
+	{
+		first = list->buf.vbuf.tsms;
+		length = (last->buf.vbuf.tsms - first) + (int)(start - last->at);
+		DBGLOG("pre-roll of %d ms, %d ms before recording.", length, (int)(start - last->at));
+
+		for (f = list; f; f = f->next)
+		{
+			f->buf.curbuf = &f->buf.vbuf;
+			f->buf.vbuf.tsms -= first;
+			if (save(&f->buf, 0)) break;
+		}
+	}
+
+	while (list)
+	{
+		f = list;
+		list = f->next;
+		free(f);
+	}
+	return length;
+}
+
+/**
+ * Get pre-roll setting and what is kept now.
+ *
+ * @param info
+ *        info buffer.
+ */
+void
+PrerollGetInfo( rec_preroll_info_t * info )
+{
+	LOCK_PREMUTEX();
+	info->seconds = seconds;
+	info->frames = frames;
+	info->bytes = bytes;
+	info->spanMs = (head && tail)? tail->buf.vbuf.tsms - head->buf.vbuf.tsms : 0;
+	UNLOCK_PREMUTEX();
+}
@@ -0,0 +1,46 @@
+#ifndef NMS_SERVER_REC_PREROLL__H
+#define NMS_SERVER_REC_PREROLL__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording pre-roll header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define PREROLL_MAX_SECONDS  60                   // longest pre-roll.
+#define PREROLL_BUDGET       (16 * 1024 * 1024)   // bytes kept at most.
+
+typedef int (*preroll_save_t)(media_buf_t *, int);
+
+void PrerollSet(int);
+void PrerollStart(const media_desc_t *);
+int  PrerollActive(void);
+void PrerollPush(const media_buf_t *);
+int  PrerollFlush(const media_desc_t *, preroll_save_t);
+void PrerollGetInfo(rec_preroll_info_t *);
+
+#endif /* NMS_SERVER_REC_PREROLL__H */
@@ -0,0 +1,224 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recorder frame queue.
+ *
+ * Each capture stream hands its frames to the mux through its own ring,
+ * written by the capture thread only and read by the mux thread only, 
+ * so neither side takes a lock. The frame payload is copied into the slot
+ * so the capture buffer goes back to the driver right away. Slot buffers 
+ * are kept and only grow, no allocation once the recording settles.
+ *
+ * The writer takes the payload buffer of a frame it commits rather than
+ * copying it, and gives it back once written through a second ring, read
+ * by the producer to refill the slots left without a buffer.
+ *
+ * REVISION:
+ * 
+ * 2) Hand payload buffers to the writer. ----------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "nmsplugin.h"
+#include "server-rec-queue.h"
+
+#define SLOT(q, n)   (&(q)->slots[(n) & (REC_QUEUE_SLOTS - 1)])
+#define SPARE(q, n)  (&(q)->spares[(n) & (REC_QUEUE_SPARES - 1)])
+
+/**
+ * Set up an empty queue, slot buffers from a previous use are kept.
+ *
+ * @param q
+ *        queue.
+ * @param audio
+ *        1: audio frames 0: video frames
+ */
+void
+RecQueueInit( rec_queue_t * q, int audio )
+{
+	q->head = q->tail = 0;
+	q->audio = audio;
+}
+
+/**
+ * Release slot and spare buffers, queue must not be in use.
+ *
+ * @param q
+ *        queue.
+ */
+void
+RecQueueFree( rec_queue_t * q )
+{
+	int ii;
+
+	for (ii = 0; ii < REC_QUEUE_SLOTS; ii++)
+	{
+		free(q->slots[ii].pay.data);
+		q->slots[ii].pay.data = NULL;
+		q->slots[ii].pay.cap = 0;
+	}
+	while (q->spareTail != q->spareHead)
+		free(SPARE(q, q->spareTail++)->data);
+	q->head = q->tail = 0;
+}
+
+/**
+ * Queue a copy of a captured frame, producer side.
+ *
+ * @param q
+ *        queue.
+ * @param buf
+ *        media buffer filled by EncInputGetBuffer.
+ * @return
+ *        0 if queued, 1 if queue is full, -1 if out of memory.
+ */
+int
+RecQueuePush( rec_queue_t * q, const media_buf_t * buf )
+{
+	rec_frame_t * f;
+	const q_buf_t * src = q->audio? &buf->abuf : &buf->vbuf;
+	q_buf_t * dst;
+
+	if (q->head - q->tail >= REC_QUEUE_SLOTS) return 1;
+	f = SLOT(q, q->head);
+
+	// payload went to the writer, reuse one it gave back.
+	if (!f->pay.data && (q->spareTail != q->spareHead))
+	{
+		// spare must not be read ahead of spareHead.
+		__sync_synchronize();
+		f->pay = *SPARE(q, q->spareTail);
+		__sync_synchronize();
+		q->spareTail++;
+	}
+	if (src->size > f->pay.cap)
+	{
+		void * p = realloc(f->pay.data, src->size);
+
+		if (!p) return -1;
+		f->pay.data = p;
+		f->pay.cap = src->size;
+	}
+	memcpy(&f->buf, buf, sizeof(media_buf_t));
+	dst = q->audio? &f->buf.abuf : &f->buf.vbuf;
+	if (src->size > 0) memcpy(f->pay.data, src->data, src->size);
+	dst->data = f->pay.data;
+	f->buf.curbuf = dst;
+
+	// frame must be complete before the consumer can see it.
+	__sync_synchronize();
+	q->head++;
+	return 0;
+}
+
+/**
+ * Get oldest frame without removing it, consumer side.
+ *
+ * @param q
+ *        queue.
+ * @return
+ *        frame, its curbuf set to the stream buffer. NULL if queue is empty.
+ */
+media_buf_t *
+RecQueuePeek( rec_queue_t * q )
+{
+	if (q->head == q->tail) return NULL;
+	// slot must not be read ahead of head.
+	__sync_synchronize();
+	return &SLOT(q, q->tail)->buf;
+}
+
+/**
+ * Remove oldest frame, consumer side.
+ *
+ * @param q
+ *        queue.
+ */
+void
+RecQueuePop( rec_queue_t * q )
+{
+	// done with the slot before the producer may refill it.
+	__sync_synchronize();
+	q->tail++;
+}
+
+/**
+ * Take payload buffer of oldest frame, consumer side. Frame data stays
+ * valid till the buffer is given back.
+ *
+ * @param q
+ *        queue.
+ * @param pay
+ *        filled with the buffer.
+ */
+void
+RecQueueTake( rec_queue_t * q, rec_payload_t * pay )
+{
+	rec_frame_t * f = SLOT(q, q->tail);
+
+	*pay = f->pay;
+	f->pay.data = NULL;
+	f->pay.cap = 0;
+}
+
+/**
+ * Give back a payload buffer taken from the queue, writer side. The 
+ * buffer is freed if enough spares are kept already.
+ *
+ * @param q
+ *        queue the buffer was taken from.
+ * @param pay
+ *        buffer.
+ */
+void
+RecQueueGiveBack( rec_queue_t * q, rec_payload_t * pay )
+{
+	if (q->spareHead - q->spareTail >= REC_QUEUE_SPARES)
+	{
+		free(pay->data);
+		return;
+	}
+	*SPARE(q, q->spareHead) = *pay;
+	// spare must be complete before the producer can see it.
+	__sync_synchronize();
+	q->spareHead++;
+}
+
+/**
+ * @param q
+ *        queue.
+ * @return
+ *        number of frames queued.
+ */
+int
+RecQueueCount( rec_queue_t * q )
+{
+	return q->head - q->tail;
+}
@@ -0,0 +1,72 @@
+#ifndef NMS_SERVER_REC_QUEUE__H
+#define NMS_SERVER_REC_QUEUE__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recorder frame queue header.
+ *
+ * REVISION:
+ * 
+ * 2) Hand payload buffers to the writer. ----------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define REC_QUEUE_SLOTS   32     // frames queued per stream, power of 2.
+#define REC_QUEUE_SPARES  64     // payload buffers given back, power of 2.
+
+/// payload buffer, moves from slot to writer and back.
+typedef struct
+{
+	void *         data;
+	int            cap;     // size of buffer.
+} rec_payload_t;
+
+/// captured frame, payload copied out of the capture buffer.
+typedef struct
+{
+	media_buf_t    buf;     // frame as captured, its data points to copy.
+	rec_payload_t  pay;     // payload copy, none once taken by the writer.
+} rec_frame_t;
+
+/// single producer, single consumer frame queue.
+typedef struct
+{
+	volatile unsigned int head;     // next slot to fill, producer only.
+	volatile unsigned int tail;     // next slot to take, consumer only.
+	int                   audio;    // 1: audio frames 0: video frames
+	rec_frame_t           slots[REC_QUEUE_SLOTS];
+	volatile unsigned int spareHead; // next spare to give back, writer only.
+	volatile unsigned int spareTail; // next spare to reuse, producer only.
+	rec_payload_t         spares[REC_QUEUE_SPARES];
+} rec_queue_t;
+
+void          RecQueueInit(rec_queue_t *, int);
+void          RecQueueFree(rec_queue_t *);
+int           RecQueuePush(rec_queue_t *, const media_buf_t *);
+media_buf_t * RecQueuePeek(rec_queue_t *);
+void          RecQueuePop(rec_queue_t *);
+void          RecQueueTake(rec_queue_t *, rec_payload_t *);
+void          RecQueueGiveBack(rec_queue_t *, rec_payload_t *);
+int           RecQueueCount(rec_queue_t *);
+
+#endif /* NMS_SERVER_REC_QUEUE__H */
@@ -0,0 +1,325 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording segments.
+ *
+ * A long recording is cut in segments, each a file of its own finalized 
+ * as it ends, so no single file grows past the plugin's limits. The first
+ * segment is the file asked for, name.ext, the next ones name-002.ext and
+ * so on. The file of the next segment is created in background while the 
+ * current one records, the switch itself only restarts the plugin. Once 
+ * a recording has more than one segment, name.m3u lists them in order 
+ * with their length, an entry is added as each segment is finished.
+ *
+ * Existing files are never overwritten: a segment or manifest name taken
+ * already is skipped for the next free number, and the manifest lists 
+ * the names actually used.
+ *
+ * REVISION:
+ * 
+ * 2) Skip names taken, never overwrite a file. ----------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "nmsplugin.h"
+#include "server-engine.h"
+#include "server-rec-segment.h"
+
+#define KEY_SCAN_BYTES  256   // headers before the VOP header of a key frame.
+
+static pthread_mutex_t    segMutex = PTHREAD_MUTEX_INITIALIZER;
+static char               segDir[PATH_MAX];   // up to and with the last '/'.
+static char               segStem[PATH_MAX];  // file name without extension.
+static char               segExt[PATH_MAX];   // extension with the '.', may be empty.
+static char               nextPath[PATH_MAX];
+static int                nextReady;          // nextPath created.
+static int                seq;                // number of last segment name taken.
+static char               curName[PATH_MAX];  // file name of segment recording now.
+static char               manifest[PATH_MAX]; // manifest path, empty till created.
+static int                current;            // segment recording now, from 1.
+static int                active;             // recording going, manifest not done.
+static int                endMs;              // length of segment being finished.
+
+#define LOCK_SEGMUTEX()   pthread_mutex_lock(&segMutex)
+#define UNLOCK_SEGMUTEX() pthread_mutex_unlock(&segMutex)
+
+// path of file idx of the recording with given extension.
+static void file_path( int idx, const char * ext, char * buf, int size )
+{
+	if (idx <= 1) snprintf(buf, size, "%s%s%s", segDir, segStem, ext);
+	else snprintf(buf, size, "%s%s-%03d%s", segDir, segStem, idx, ext);
+}
+
+// create file idx or a later one if taken, -1 if none could be created.
+static int create_free( int * idx, const char * ext, char * path, int size )
+{
+	int fd;
+
+	do 
+	{
+		file_path(*idx, ext, path, size);
+		fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	}
+	while ((fd < 0) && (errno == EEXIST) && (++*idx < SEGMENT_NAMES));
+	return fd;
+}
+
+// add a finished segment to the manifest, creating it with the first.
+static void manifest_add( const char * name, int ms )
+{
+	FILE * f;
+
+	if (!manifest[0])
+	{
+		int idx = 1;
+		int fd = create_free(&idx, SEGMENT_MANIFEST, manifest, sizeof(manifest));
+
+		f = (fd < 0)? NULL : fdopen(fd, "w");
+		if (f) fprintf(f, "#EXTM3U\n");
+		else if (fd >= 0) close(fd);
+	}
+	else f = fopen(manifest, "a");
+	if (!f)
+	{
+		WPRINT("unable to write segment manifest %s: %s", manifest, strerror(errno));
+		return;
+	}
+	fprintf(f, "#EXTINF:%d,%s\n%s\n", (ms + 999) / 1000, name, name);
+	fclose(f);
+}
+
+// creates the file of the next segment, so the switch finds it in place.
+static void * prepareLoop( void * arg )
+{
+	char path[PATH_MAX];
+	int idx;
+	int fd;
+
+	LOCK_SEGMUTEX();
+	idx = seq + 1;
+	UNLOCK_SEGMUTEX();
+
+	fd = create_free(&idx, segExt, path, sizeof(path));
+	if (fd < 0) WPRINT("unable to create segment %s: %s", path, strerror(errno));
+	else close(fd);
+
+	LOCK_SEGMUTEX();
+	seq = idx;
+	strcpy(nextPath, path);
+	nextReady = (fd >= 0);
+	UNLOCK_SEGMUTEX();
+	DBGLOG("segment %s prepared.", path);
+	return NULL;
+}
+
+/**
+ * Start cutting a new recording in segments, prepares the second one.
+ *
+ * @param fname
+ *        file of the first segment.
+ * @return
+ *        0 if next segment is being prepared.
+ */
+int
+SegmentStart( const char * fname )
+{
+	const char * base;
+	const char * ext;
+
+	EngineWait(ENGINE_REC_SEGMENT);
+
+	base = strrchr(fname, '/');
+	base = base? base + 1 : fname;
+	ext = strrchr(base, '.');
+	if (!ext || (ext == base)) ext = base + strlen(base);
+
+	LOCK_SEGMUTEX();
+	snprintf(segDir, sizeof(segDir), "%.*s", (int)(base - fname), fname);
+	snprintf(segStem, sizeof(segStem), "%.*s", (int)(ext - base), base);
+	snprintf(segExt, sizeof(segExt), "%s", ext);
+	snprintf(curName, sizeof(curName), "%s", base);
+	manifest[0] = 0;
+	nextReady = 0;
+	seq = 1;
+	current = 1;
+	endMs = 0;
+	active = 1;
+	UNLOCK_SEGMUTEX();
+
+	return EngineSubmit(ENGINE_REC_SEGMENT, prepareLoop, NULL);
+}
+
+/**
+ * Get the file of the next segment, waits till it is prepared.
+ *
+ * @param buf
+ *        path buffer.
+ * @param size
+ *        buffer size.
+ * @return
+ *        0 if next segment is ready.
+ */
+int
+SegmentNext( char * buf, int size )
+{
+	int ret = -1;
+
+	EngineWait(ENGINE_REC_SEGMENT);
+
+	LOCK_SEGMUTEX();
+	if (nextReady)
+	{
+		snprintf(buf, size, "%s", nextPath);
+		ret = 0;
+	}
+	UNLOCK_SEGMUTEX();
+	return ret;
+}
+
+/**
+ * Current segment ends, the next one starts with the frame at hand.
+ *
+ * @param ms
+ *        length of the segment ending, mili-seconds.
+ */
+void
+SegmentEnd( int ms )
+{
+	LOCK_SEGMUTEX();
+	endMs = ms;
+	UNLOCK_SEGMUTEX();
+}
+
+/**
+ * Plugin switched over to the next segment: the one before is listed in
+ * the manifest, and the one after is prepared.
+ */
+void
+SegmentSwitched( void )
+{
+	char name[PATH_MAX];
+	int idx, ms;
+
+	LOCK_SEGMUTEX();
+	idx = current++;
+	ms = endMs;
+	strcpy(name, curName);
+	strcpy(curName, nextPath + strlen(segDir));
+	nextReady = 0;
+	UNLOCK_SEGMUTEX();
+
+	manifest_add(name, ms);
+	if (EngineSubmit(ENGINE_REC_SEGMENT, prepareLoop, NULL))
+		WPRINT("segment after %d not prepared.", idx + 1);
+}
+
+/**
+ * Recording stopped: last segment is listed and a segment prepared but 
+ * not used is removed.
+ *
+ * @param ms
+ *        length of the last segment, mili-seconds.
+ */
+void
+SegmentStop( int ms )
+{
+	char name[PATH_MAX];
+	int idx;
+
+	EngineWait(ENGINE_REC_SEGMENT);
+
+	LOCK_SEGMUTEX();
+	if (!active)
+	{
+		UNLOCK_SEGMUTEX();
+		return;
+	}
+	active = 0;
+	idx = current;
+	strcpy(name, curName);
+	if (nextReady && remove(nextPath))
+		WPRINT("unable to remove segment %s: %s", nextPath, strerror(errno));
+	nextReady = 0;
+	UNLOCK_SEGMUTEX();
+
+	if (idx > 1) manifest_add(name, ms);
+}
+
+/**
+ * Tell if a video frame may start a segment.
+ *
+ * @param type
+ *        video codec.
+ * @param data
+ *        frame data.
+ * @param size
+ *        frame size.
+ * @return
+ *        nonzero for a key frame; frames of codecs other than MPEG-4 are
+ *        taken as intra coded.
+ */
+int
+SegmentIsKeyFrame( int type, const void * data, int size )
+{
+	const unsigned char * p = data;
+	int ii;
+
+	if (type != NMS_VC_MPEG4) return 1;
+
+	// VOP start code, then two bits of coding type, 0 is intra.
+	if (size > KEY_SCAN_BYTES) size = KEY_SCAN_BYTES;
+	for (ii = 0; ii + 4 < size; ii++)
+		if (!p[ii] && !p[ii + 1] && (p[ii + 2] == 1) && (p[ii + 3] == 0xb6))
+			return !(p[ii + 4] >> 6);
+	return 0;
+}
+
+/**
+ * Get segment figures of current or last recording.
+ *
+ * @param s
+ *        info buffer, only the segment count and readiness are set.
+ */
+void
+SegmentGetInfo( rec_segment_info_t * s )
+{
+	LOCK_SEGMUTEX();
+	s->segments = current;
+	s->nextReady = nextReady;
+	UNLOCK_SEGMUTEX();
+}
@@ -0,0 +1,49 @@
+#ifndef NMS_SERVER_REC_SEGMENT__H
+#define NMS_SERVER_REC_SEGMENT__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording segments header.
+ *
+ * REVISION:
+ * 
+ * 3) Added bound on names tried. ------------------------- 2026-10-19
+ * 2) Added finalization bound. --------------------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define SEGMENT_LENGTH      (60 * 60)            // segment length, unit: second
+#define SEGMENT_KEY_MARGIN  (32 * 1024 * 1024)   // bytes left to reach a key frame before size limit.
+#define SEGMENT_FINALIZATION (16 * 1024 * 1024)  // finalization needs that make a segment due.
+#define SEGMENT_MANIFEST    ".m3u"               // manifest extension, replaces the recording one.
+#define SEGMENT_NAMES       1000                 // name-002 up to name-999 are tried.
+
+int  SegmentStart(const char *);
+int  SegmentNext(char *, int);
+void SegmentEnd(int);
+void SegmentSwitched(void);
+void SegmentStop(int);
+int  SegmentIsKeyFrame(int, const void *, int);
+void SegmentGetInfo(rec_segment_info_t *);
+
+#endif /* NMS_SERVER_REC_SEGMENT__H */
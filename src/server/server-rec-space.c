@@ -0,0 +1,258 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording free space monitor.
+ *
+ * Free space of the recording file system is sampled in the background
+ * while recording, the commit path only reads the last result. Between 
+ * samples the disk fills by what the recording writes, which the commit
+ * path accounts itself, and by whatever else writes to the same disk; 
+ * the latter is estimated from the samples and taken off in advance for
+ * the time till the next sample. Samples get more frequent as the disk 
+ * gets closer to full.
+ *
+ * Space is expressed as a budget for recording size: free space plus what
+ * the recording had written when sampled, so it compares directly against
+ * recording size.
+ *
+ * REVISION:
+ * 
+ * 4) Space reserved ahead counted as free. ------------- 2026-10-19
+ * 3) Recording size accounted in 64 bits. -------------- 2026-10-19
+ * 2) Read finalization requirement lock free. ----------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <sys/statvfs.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "nmsplugin.h"
+#include "plugin-internals.h"
+#include "server-engine.h"
+#include "server-rec-queue.h"
+#include "server-rec-writer.h"
+#include "server-rec-space.h"
+#include "server-rec-prealloc.h"
+
+static pthread_mutex_t    spaceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     spaceCond = PTHREAD_COND_INITIALIZER;
+static char               spacePath[PATH_MAX];
+static int                quit;
+static unsigned long long budget;    // recording size the disk can take.
+static rec_space_info_t   info;
+
+#define LOCK_SPACEMUTEX()   pthread_mutex_lock(&spaceMutex)
+#define UNLOCK_SPACEMUTEX() pthread_mutex_unlock(&spaceMutex)
+
+static unsigned int ms_since( const struct timeval * t )
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - t->tv_sec) * 1000 + (now.tv_usec - t->tv_usec) / 1000;
+}
+
+// bytes per second over ms, smoothed into rate.
+static unsigned int ewma( unsigned int rate, unsigned long long bytes, unsigned int ms, int first )
+{
+	unsigned int sample = ms? (unsigned int)(bytes * 1000 / ms) : 0;
+
+	return first? sample : (rate * 3 + sample) / 4;
+}
+
+// recording bytes already on disk.
+static unsigned long long written( void )
+{
+	rec_writer_stats_t ws;
+	unsigned long long size = SrvGetRecordsize64();
+
+	WriterGetStats(&ws);
+	return (size > ws.bytes)? size - ws.bytes : 0;
+}
+
+static void * spaceLoop( void * arg )
+{
+	struct statvfs st;
+	struct timeval last;
+	struct timespec due;
+	unsigned long long prevFree = 0;
+	unsigned long long prevOurs = 0;
+	unsigned long long freeBytes, ours, reserve, other;
+	unsigned int interval = SPACE_TICK_MIN;
+	unsigned int ms;
+	int first = 1;
+
+	LOCK_SPACEMUTEX();
+	prevFree = info.freeBytes;
+	UNLOCK_SPACEMUTEX();
+	gettimeofday(&last, NULL);
+	while (1)
+	{
+		LOCK_SPACEMUTEX();
+		due.tv_sec = last.tv_sec + interval;
+		due.tv_nsec = last.tv_usec * 1000;
+		while (!quit && (ETIMEDOUT != pthread_cond_timedwait(&spaceCond, &spaceMutex, &due)));
+		if (quit)
+		{
+			UNLOCK_SPACEMUTEX();
+			break;
+		}
+		UNLOCK_SPACEMUTEX();
+
+		if (statvfs(spacePath, &st))
+		{
+			WPRINT("statvfs(%s) failed: %s", spacePath, strerror(errno));
+			gettimeofday(&last, NULL);
+			continue;
+		}
+		// space reserved ahead of the recording is still free for it.
+		freeBytes = (unsigned long long)st.f_bfree * st.f_frsize + PreallocAhead();
+		ours = written();
+		ms = ms_since(&last);
+		gettimeofday(&last, NULL);
+
+		LOCK_SPACEMUTEX();
+		info.freeBytes = freeBytes;
+		info.samples++;
+		info.diskRate = ewma(info.diskRate, (prevFree > freeBytes)? prevFree - freeBytes : 0, ms, first);
+		info.recordRate = ewma(info.recordRate, (ours > prevOurs)? ours - prevOurs : 0, ms, first);
+		first = 0;
+		prevFree = freeBytes;
+		prevOurs = ours;
+
+		// space finalization needs stays off limits.
+		reserve = WriterGetFinalization();
+		info.secondsLeft = -1;
+		if (info.diskRate && (freeBytes > reserve))
+			info.secondsLeft = (freeBytes - reserve) / info.diskRate;
+		else if (freeBytes <= reserve) 
+			info.secondsLeft = 0;
+
+		// sample more often as the disk gets full.
+		interval = SPACE_TICK_MAX;
+		if ((info.secondsLeft >= 0) && (info.secondsLeft / SPACE_TICK_DIVISOR < interval))
+			interval = info.secondsLeft / SPACE_TICK_DIVISOR;
+		if (interval < SPACE_TICK_MIN) interval = SPACE_TICK_MIN;
+		info.interval = interval;
+
+		// others keep writing till next sample.
+		other = (info.diskRate > info.recordRate)? info.diskRate - info.recordRate : 0;
+		other *= interval;
+		budget = (freeBytes > other)? freeBytes - other + ours : ours;
+		UNLOCK_SPACEMUTEX();
+
+		DBGLOG("free %llu bytes, disk %u B/s, recording %u B/s, %d s left.", 
+			   freeBytes, info.diskRate, info.recordRate, info.secondsLeft);
+	}
+	return NULL;
+}
+
+/**
+ * Set budget for a new recording, before it commits anything.
+ *
+ * @param freeBytes
+ *        free space when recording starts.
+ */
+void
+SpaceReset( unsigned long long freeBytes )
+{
+	LOCK_SPACEMUTEX();
+	budget = freeBytes;
+	memset(&info, 0, sizeof(rec_space_info_t));
+	info.freeBytes = freeBytes;
+	info.secondsLeft = -1;
+	info.interval = SPACE_TICK_MIN;
+	UNLOCK_SPACEMUTEX();
+}
+
+/**
+ * Start monitoring free space.
+ *
+ * @param path
+ *        file being recorded.
+ * @return
+ *        0 if monitor started.
+ */
+int
+SpaceStart( const char * path )
+{
+	LOCK_SPACEMUTEX();
+	strncpy(spacePath, path, PATH_MAX - 1);
+	spacePath[PATH_MAX - 1] = 0;
+	quit = 0;
+	UNLOCK_SPACEMUTEX();
+
+	return EngineSubmit(ENGINE_REC_SPACE, spaceLoop, NULL);
+}
+
+/**
+ * Stop monitoring free space, last figures stay.
+ */
+void
+SpaceStop( void )
+{
+	LOCK_SPACEMUTEX();
+	quit = 1;
+	UNLOCK_SPACEMUTEX();
+	pthread_cond_broadcast(&spaceCond);
+
+	EngineWait(ENGINE_REC_SPACE);
+}
+
+/**
+ * @return
+ *        recording size the disk can take, finalization not accounted.
+ */
+unsigned long long
+SpaceGetBudget( void )
+{
+	unsigned long long b;
+
+	LOCK_SPACEMUTEX();
+	b = budget;
+	UNLOCK_SPACEMUTEX();
+	return b;
+}
+
+/**
+ * Get free space and fill rate estimates.
+ *
+ * @param s
+ *        info buffer.
+ */
+void
+SpaceGetInfo( rec_space_info_t * s )
+{
+	LOCK_SPACEMUTEX();
+	memcpy(s, &info, sizeof(rec_space_info_t));
+	UNLOCK_SPACEMUTEX();
+}
@@ -0,0 +1,44 @@
+#ifndef NMS_SERVER_REC_SPACE__H
+#define NMS_SERVER_REC_SPACE__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording free space monitor header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define SPACE_TICK_MIN      1     // shortest refresh interval, unit: second
+#define SPACE_TICK_MAX      30    // longest refresh interval, unit: second
+#define SPACE_TICK_DIVISOR  20    // refresh this many times over the time left.
+
+void SpaceReset(unsigned long long);
+int  SpaceStart(const char *);
+void SpaceStop(void);
+unsigned long long SpaceGetBudget(void);
+void SpaceGetInfo(rec_space_info_t *);
+
+#endif /* NMS_SERVER_REC_SPACE__H */
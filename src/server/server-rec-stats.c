@@ -0,0 +1,264 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording statistics.
+ *
+ * Capture, mux and writer threads count what happens to every frame: 
+ * taken from encoder input, waited for the mux, lost, written; commit 
+ * latency and the a/v gap the mux sees go in log2 histograms. Figures 
+ * of the recording going are read by command, and logged as a summary 
+ * when it ends, to tell where a recording with glitches lost time.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "server-rec-stats.h"
+
+static pthread_mutex_t    statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static rec_stats_t        stats;
+static struct timeval     started;
+static int                active;   // recording counted, summary not logged.
+
+#define LOCK_STATSMUTEX()   pthread_mutex_lock(&statsMutex)
+#define UNLOCK_STATSMUTEX() pthread_mutex_unlock(&statsMutex)
+
+static int bucket( unsigned int v )
+{
+	int b = 0;
+
+	while ((v >>= 1) && (b < REC_STATS_BUCKETS - 1)) b++;
+	return b;
+}
+
+// upper bound of the bucket holding percentile pc of the histogram.
+static unsigned int percentile( const unsigned int * h, int pc )
+{
+	unsigned long long total = 0;
+	unsigned long long seen = 0;
+	int b;
+
+	for (b = 0; b < REC_STATS_BUCKETS; b++) total += h[b];
+	if (!total) return 0;
+	for (b = 0; b < REC_STATS_BUCKETS - 1; b++)
+	{
+		seen += h[b];
+		if (seen * 100 >= total * pc) break;
+	}
+	return 2u << b;
+}
+
+// time derived figures, under lock.
+static void update( void )
+{
+	struct timeval now;
+	unsigned int ms;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - started.tv_sec) * 1000 + (now.tv_usec - started.tv_usec) / 1000;
+	stats.seconds = ms / 1000;
+	stats.bytesPerSec = ms? (unsigned int)(stats.bytes * 1000 / ms) : 0;
+}
+
+/**
+ * Start counting for a new recording.
+ */
+void
+StatsReset( void )
+{
+	LOCK_STATSMUTEX();
+	memset(&stats, 0, sizeof(rec_stats_t));
+	gettimeofday(&started, NULL);
+	active = 1;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count a frame taken from encoder input and queued for the mux.
+ *
+ * @param audio
+ *        nonzero for audio stream.
+ * @param depth
+ *        frames queued, this one included.
+ */
+void
+StatsCaptured( int audio, unsigned int depth )
+{
+	rec_stream_stats_t * s = audio? &stats.audio : &stats.video;
+
+	LOCK_STATSMUTEX();
+	s->captured++;
+	if (depth > s->maxDepth) s->maxDepth = depth;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count encoder input having no frame in time.
+ *
+ * @param audio
+ *        nonzero for audio stream.
+ */
+void
+StatsTimeout( int audio )
+{
+	LOCK_STATSMUTEX();
+	if (audio) stats.audio.timeouts++;
+	else stats.video.timeouts++;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count a frame that waited for the mux to make room.
+ *
+ * @param audio
+ *        nonzero for audio stream.
+ * @param ms
+ *        time waited, mili-seconds.
+ */
+void
+StatsQueueFull( int audio, unsigned int ms )
+{
+	LOCK_STATSMUTEX();
+	if (audio) stats.audio.queueFull++;
+	else stats.video.queueFull++;
+	stats.waitMs += ms;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count a frame lost before the mux.
+ *
+ * @param audio
+ *        nonzero for audio stream.
+ */
+void
+StatsDropped( int audio )
+{
+	LOCK_STATSMUTEX();
+	if (audio) stats.audio.dropped++;
+	else stats.video.dropped++;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count gap between audio and video time stamps the mux picks from.
+ *
+ * @param ms
+ *        gap, mili-seconds.
+ */
+void
+StatsAvGap( int ms )
+{
+	unsigned int gap = (ms < 0)? -ms : ms;
+
+	LOCK_STATSMUTEX();
+	stats.avGapMs[bucket(gap)]++;
+	if (gap > stats.avGapMaxMs) stats.avGapMaxMs = gap;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Count a frame the plugin committed.
+ *
+ * @param audio
+ *        nonzero for audio stream.
+ * @param bytes
+ *        frame size.
+ * @param us
+ *        commit latency, micro-seconds.
+ */
+void
+StatsCommitted( int audio, unsigned int bytes, unsigned int us )
+{
+	LOCK_STATSMUTEX();
+	if (audio) stats.audio.committed++;
+	else stats.video.committed++;
+	stats.bytes += bytes;
+	stats.commitUs[bucket(us)]++;
+	if (us > stats.commitMaxUs) stats.commitMaxUs = us;
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Get statistics of current or last recording.
+ *
+ * @param s
+ *        statistics buffer.
+ */
+void
+StatsGet( rec_stats_t * s )
+{
+	LOCK_STATSMUTEX();
+	if (active) update();
+	memcpy(s, &stats, sizeof(rec_stats_t));
+	UNLOCK_STATSMUTEX();
+}
+
+/**
+ * Log statistics of the recording just ended, once.
+ */
+void
+StatsSummary( void )
+{
+	rec_stats_t s;
+	const rec_stream_stats_t * st;
+	int ii;
+
+	LOCK_STATSMUTEX();
+	if (!active)
+	{
+		UNLOCK_STATSMUTEX();
+		return;
+	}
+	update();
+	active = 0;
+	memcpy(&s, &stats, sizeof(rec_stats_t));
+	UNLOCK_STATSMUTEX();
+
+	WARNLOG("recording ended: %u s, %llu bytes, %u B/s, capture waited %u ms for mux.",
+			s.seconds, s.bytes, s.bytesPerSec, s.waitMs);
+	for (ii = 0; ii < 2; ii++)
+	{
+		st = ii? &s.video : &s.audio;
+		WARNLOG("  %s: %u captured, %u committed, %u timeouts, %u waited, %u dropped, %u queued at most.",
+				ii? "video" : "audio", st->captured, st->committed, st->timeouts, 
+				st->queueFull, st->dropped, st->maxDepth);
+	}
+	WARNLOG("  commit: 50%% < %u us, 99%% < %u us, max %u us.",
+			percentile(s.commitUs, 50), percentile(s.commitUs, 99), s.commitMaxUs);
+	WARNLOG("  a/v gap: 50%% < %u ms, 99%% < %u ms, max %u ms.",
+			percentile(s.avGapMs, 50), percentile(s.avGapMs, 99), s.avGapMaxMs);
+}
@@ -0,0 +1,621 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording timers.
+ *
+ * Recordings set to start at a given time are kept as a table of 
+ * REC_TIMER_SLOTS fixed size records in TIMER_FILE, each with its own 
+ * checksum as the play history does, so they survive restarts. Timers
+ * waiting are hashed by the second of their next event onto a wheel of 
+ * TIMER_WHEEL_SLOTS one second buckets, walked by a thread of its own 
+ * waking at every whole second; a late wake catches up with the buckets
+ * it missed.
+ *
+ * TIMER_PREWARM seconds before start, the file name is expanded, the output
+ * plugin is looked up, the disk is checked and the file is created with its
+ * first chunk reserved, so that at start little but the plugins themselves
+ * is left to do. A timer never stops a recording it did not start, nor 
+ * starts over one going; both are told under recorder control, as the 
+ * commands of clients are.
+ *
+ * The monitor shares the capture, a timer keeps it stopped for its 
+ * recording as clients do, through the suppression list with the server 
+ * pid, and lets it run again once its recording ends.
+ *
+ * REVISION:
+ * 
+ * 3) Keep monitor stopped while recording. --------------- 2026-10-19
+ * 2) Record under recorder control. ---------------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/statvfs.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "nmsplugin.h"
+#include "plugin-internals.h"
+#include "server-engine.h"
+#include "server-rec-prealloc.h"
+#include "server-rec-timer.h"
+#include "nms-hash.h"
+
+#define TIMER_MAGIC    0x544d4e53 // "SNMT"
+#define TIMER_VERSION  1
+#define NIL            (-1)
+
+typedef struct
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int slots;
+	unsigned int reclen;
+} timer_hdr_t;
+
+/// on-disk timer record
+typedef struct
+{
+	unsigned int crc;    ///checksum over the rest of the record
+	unsigned int used;   ///0 for an unused slot
+	rec_timer_t  t;
+} timer_rec_t;
+
+static pthread_mutex_t    timerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     timerCond = PTHREAD_COND_INITIALIZER;    // wakes no one, timed waits only.
+static timer_rec_t        recs[REC_TIMER_SLOTS];
+static unsigned int       due[REC_TIMER_SLOTS];     // second of next event.
+static short              chain[REC_TIMER_SLOTS];   // next in wheel bucket.
+static char               created[REC_TIMER_SLOTS]; // file created ahead.
+static unsigned int       owned[REC_TIMER_SLOTS];   // recording count of the one started.
+static short              wheel[TIMER_WHEEL_SLOTS];
+static unsigned int       ticked;    // last second handled.
+static int                firing = NIL; // timer whose event is being handled.
+static int                lastId;
+static int                timerFd = -1;
+static unsigned int       monitorHeld; // recording count monitor is stopped for, under recorder control.
+
+#define LOCK_TIMERMUTEX()   pthread_mutex_lock(&timerMutex)
+#define UNLOCK_TIMERMUTEX() pthread_mutex_unlock(&timerMutex)
+
+static unsigned int recCrc( const timer_rec_t * r )
+{
+	return NmsHash(&r->used, sizeof(timer_rec_t) - sizeof(r->crc), NMS_HASH_SEED);
+}
+
+static void writeRec( int slot )
+{
+	off_t off;
+
+	recs[slot].crc = recCrc(&recs[slot]);
+	if (timerFd < 0) return;
+
+	off = sizeof(timer_hdr_t) + (off_t)slot * sizeof(timer_rec_t);
+	if (pwrite(timerFd, &recs[slot], sizeof(timer_rec_t), off) != sizeof(timer_rec_t))
+		WPRINT("unable to write recording timer.");
+	fdatasync(timerFd);
+}
+
+static int createFile( void )
+{
+	timer_hdr_t hdr;
+
+	hdr.magic = TIMER_MAGIC;
+	hdr.version = TIMER_VERSION;
+	hdr.slots = REC_TIMER_SLOTS;
+	hdr.reclen = sizeof(timer_rec_t);
+
+	if ((ftruncate(timerFd, 0) != 0) ||
+		(pwrite(timerFd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) ||
+		(pwrite(timerFd, recs, sizeof(recs), sizeof(hdr)) != sizeof(recs)))
+		return -1;
+	fdatasync(timerFd);
+	return 0;
+}
+
+/* ---------------- timer wheel. ---------------- */
+
+static int waiting( int state )
+{
+	return (state == REC_TIMER_PENDING) || (state == REC_TIMER_WARM) ||
+		(state == REC_TIMER_RECORDING);
+}
+
+// second the next event of a timer is due.
+static unsigned int eventTime( const rec_timer_t * t )
+{
+	switch (t->state)
+	{
+	case REC_TIMER_PENDING:
+		return (t->start > TIMER_PREWARM)? t->start - TIMER_PREWARM : 0;
+	case REC_TIMER_WARM:
+		return t->start;
+	default:
+		return t->start + t->duration;
+	}
+}
+
+static void wheelInsert( int slot )
+{
+	unsigned int when = eventTime(&recs[slot].t);
+
+	// buckets passed already are not walked again till the wheel turns.
+	if (when <= ticked) when = ticked + 1;
+	due[slot] = when;
+	NmsChainAdd(wheel, TIMER_WHEEL_SLOTS, chain, slot, when);
+}
+
+static void wheelRemove( int slot )
+{
+	NmsChainRemove(wheel, TIMER_WHEEL_SLOTS, chain, slot, due[slot]);
+}
+
+// take a timer due by second sec off its bucket, recordings to stop first
+// so one ending makes way for the next.
+static int takeDue( unsigned int sec )
+{
+	int found = NIL;
+	int slot;
+
+	for (slot = wheel[sec % TIMER_WHEEL_SLOTS]; slot != NIL; slot = chain[slot])
+	{
+		if (due[slot] > sec) continue;
+		found = slot;
+		if (recs[slot].t.state == REC_TIMER_RECORDING) break;
+	}
+	if (found != NIL) wheelRemove(found);
+	return found;
+}
+
+static int findId( int id )
+{
+	int ii;
+
+	for (ii = 0; ii < REC_TIMER_SLOTS; ii++)
+		if (recs[ii].used && (recs[ii].t.id == id)) return ii;
+	return NIL;
+}
+
+/* ---------------- timer events. ---------------- */
+
+// drop a file created ahead that was never recorded into.
+static void discard( const char * file )
+{
+	struct stat st;
+
+	if (!stat(file, &st) && !st.st_size) remove(file);
+}
+
+static int prewarm( rec_timer_t * t, int * made )
+{
+	time_t start = t->start;
+	struct tm tm;
+	struct statvfs st;
+	media_desc_t desc;
+	char dir[REC_TIMER_PATH];
+	char * s;
+	unsigned long long freeBytes, need;
+	unsigned int kbps = 0;
+
+	localtime_r(&start, &tm);
+	if (!strftime(t->file, REC_TIMER_PATH, t->path, &tm))
+	{
+		WARNLOG("timer %d: file name %s does not expand.", t->id, t->path);
+		t->error = NMS_RECORD_START_OTHER;
+		return REC_TIMER_FAILED;
+	}
+
+	// plugins selected are shared with the recorder, leave them while in use.
+	SrvLockRecorder();
+	if (!SrvIsRecording() && !SrvIsMonitorActive())
+	{
+		memset(&desc, 0, sizeof(media_desc_t));
+		if (!EncOutputIsOurFormat(&t->ctrl, t->file, &desc))
+		{
+			SrvUnlockRecorder();
+			WARNLOG("timer %d: no encoder output plugin for %s.", t->id, t->file);
+			t->error = NMS_RECORD_PARAMS_UNSUPPORTED;
+			return REC_TIMER_FAILED;
+		}
+		if (desc.vdesc.video_type != NMS_VC_NO_VIDEO) kbps += desc.vdesc.bitrate;
+		if (desc.adesc.audio_type != NMS_AC_NO_AUDIO) kbps += PREALLOC_AUDIO_KBPS;
+	}
+	SrvUnlockRecorder();
+
+	strcpy(dir, t->file);
+	s = strrchr(dir, '/');
+	if (!s) strcpy(dir, ".");
+	else if (s == dir) s[1] = 0;
+	else *s = 0;
+	if (statvfs(dir, &st))
+	{
+		WARNLOG("timer %d: statvfs(%s) failed: %s", t->id, dir, strerror(errno));
+		t->error = NMS_RECORD_OUT_DISKSPACE;
+		return REC_TIMER_FAILED;
+	}
+	freeBytes = (unsigned long long)st.f_bfree * st.f_frsize;
+	if (freeBytes < PREALLOC_MIN)
+	{
+		WARNLOG("timer %d: disk full.", t->id);
+		t->error = NMS_RECORD_OUT_DISKSPACE;
+		return REC_TIMER_FAILED;
+	}
+	need = (unsigned long long)kbps * 1000 / 8 * t->duration;
+	if (freeBytes < need)
+		WARNLOG("timer %d: %llu bytes free of %llu needed, recording will end early.", 
+				t->id, freeBytes, need);
+
+	*made = !PreallocWarm(t->file, kbps);
+	DBGLOG("timer %d: %s prepared.", t->id, t->file);
+	return REC_TIMER_WARM;
+}
+
+// start recording, count set to the one started.
+static int begin( rec_timer_t * t, unsigned int * count )
+{
+	NMS_SRV_ERROR_DETAIL detail;
+	struct timeval now;
+	long long ms;
+
+	SrvLockRecorder();
+	if (SrvIsRecording())
+	{
+		SrvUnlockRecorder();
+		WARNLOG("timer %d: recorder busy, not started.", t->id);
+		t->error = NMS_RECORD_START_OTHER;
+		return REC_TIMER_FAILED;
+	}
+	SrvStopMonitor(getpid());
+	if (SrvRecord(&t->ctrl, t->file, &detail) != NMS_RECORD_OK)
+	{
+		monitorHeld = 0;
+		SrvStartMonitor(getpid());
+		SrvUnlockRecorder();
+		WARNLOG("timer %d: recording not started (%d).", t->id, detail.error);
+		t->error = detail.error;
+		return REC_TIMER_FAILED;
+	}
+	*count = SrvGetRecordCount();
+	monitorHeld = *count;
+	SrvUnlockRecorder();
+
+	gettimeofday(&now, NULL);
+	ms = ((long long)now.tv_sec - t->start) * 1000 + now.tv_usec / 1000;
+	t->lateMs = (ms > 0)? ms : 0;
+	if (t->lateMs > TIMER_LATE_MS)
+		WARNLOG("timer %d: recording started %d ms late.", t->id, t->lateMs);
+	return REC_TIMER_RECORDING;
+}
+
+// stop recording a timer started, if it is still the one going, and let
+// the monitor run again unless held for a later one.
+static void finish( unsigned int count )
+{
+	SrvLockRecorder();
+	if (count && SrvIsRecording() && (SrvGetRecordCount() == count))
+		SrvStopRecord();
+	if (count && (monitorHeld == count))
+	{
+		monitorHeld = 0;
+		SrvStartMonitor(getpid());
+	}
+	SrvUnlockRecorder();
+}
+
+// handle event of a timer taken off the wheel, timer lock held.
+static void fire( int slot )
+{
+	rec_timer_t t;
+	unsigned int count = 0;
+	int made = 0;
+	int state;
+
+	memcpy(&t, &recs[slot].t, sizeof(rec_timer_t));
+	firing = slot;
+	UNLOCK_TIMERMUTEX();
+
+	switch (t.state)
+	{
+	case REC_TIMER_PENDING:
+		state = prewarm(&t, &made);
+		break;
+	case REC_TIMER_WARM:
+		state = begin(&t, &count);
+		break;
+	default:
+		LOCK_TIMERMUTEX();
+		count = owned[slot];
+		UNLOCK_TIMERMUTEX();
+		finish(count);
+		count = 0;
+		state = REC_TIMER_DONE;
+		break;
+	}
+
+	LOCK_TIMERMUTEX();
+	firing = NIL;
+	if (findId(t.id) != slot)
+	{
+		// removed meanwhile, undo what was done for it.
+		UNLOCK_TIMERMUTEX();
+		finish(count);
+		if (made) discard(t.file);
+		LOCK_TIMERMUTEX();
+		return;
+	}
+	if (made) created[slot] = 1;
+	owned[slot] = count;
+	if ((state == REC_TIMER_FAILED) && created[slot])
+	{
+		discard(t.file);
+		created[slot] = 0;
+	}
+	t.state = state;
+	memcpy(&recs[slot].t, &t, sizeof(rec_timer_t));
+	if (waiting(state)) wheelInsert(slot);
+	writeRec(slot);
+}
+
+static void * timerLoop( void * arg )
+{
+	struct timespec wake;
+	unsigned int now;
+	int slot;
+
+	while (1)
+	{
+		LOCK_TIMERMUTEX();
+		wake.tv_sec = ticked + 1;
+		wake.tv_nsec = 0;
+		while (ETIMEDOUT != pthread_cond_timedwait(&timerCond, &timerMutex, &wake));
+
+		now = time(NULL);
+		// a late wake or the clock set forward walks every second missed, 
+		// a wheel turn at most; set back, the seconds handled just wait.
+		if (now > ticked + TIMER_WHEEL_SLOTS) ticked = now - TIMER_WHEEL_SLOTS;
+		while (ticked < now)
+		{
+			ticked++;
+			while ((slot = takeDue(ticked)) != NIL)
+				fire(slot);
+		}
+		UNLOCK_TIMERMUTEX();
+	}
+	return NULL;
+}
+
+/**
+ * Load recording timers from disk and start running them.
+ * Timers failing their checksum are dropped, ones missed while the 
+ * server was down fail, a missing or foreign file is recreated empty.
+ * Timers are kept in memory only if the file can not be used.
+ *
+ * @return
+ *        0 if timers are running.
+ */
+int
+TimerInit( void )
+{
+	timer_hdr_t hdr;
+	unsigned int now = time(NULL);
+	int n = 0;
+	int ii;
+
+	LOCK_TIMERMUTEX();
+	memset(recs, 0, sizeof(recs));
+	memset(created, 0, sizeof(created));
+	memset(wheel, NIL, sizeof(wheel));
+	ticked = now;
+
+	timerFd = open(TIMER_FILE, O_RDWR | O_CREAT, 0644);
+	if (timerFd < 0)
+	{
+		WPRINT("recording timers not persistent: %s", strerror(errno));
+		goto bail;
+	}
+
+	if ((pread(timerFd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) ||
+		(hdr.magic != TIMER_MAGIC) || (hdr.version != TIMER_VERSION) ||
+		(hdr.slots != REC_TIMER_SLOTS) || (hdr.reclen != sizeof(timer_rec_t)) ||
+		(pread(timerFd, recs, sizeof(recs), sizeof(hdr)) != sizeof(recs)))
+	{
+		DBGLOG("creating new recording timers.");
+		memset(recs, 0, sizeof(recs));
+		if (createFile())
+		{
+			WPRINT("unable to create recording timers.");
+			close(timerFd);
+			timerFd = -1;
+		}
+		goto bail;
+	}
+
+	for (ii = 0; ii < REC_TIMER_SLOTS; ii++)
+	{
+		rec_timer_t * t = &recs[ii].t;
+
+		if (!recs[ii].used) continue;
+		if (recs[ii].crc != recCrc(&recs[ii]))
+		{
+			WPRINT("dropping damaged recording timer.");
+			memset(&recs[ii], 0, sizeof(timer_rec_t));
+			continue;
+		}
+		if (t->id > lastId) lastId = t->id;
+		n++;
+		if (!waiting(t->state)) continue;
+
+		// a recording cut by the restart is not picked up again.
+		if ((t->state == REC_TIMER_RECORDING) || (t->start + t->duration <= now))
+		{
+			t->state = REC_TIMER_FAILED;
+			t->error = NMS_RECORD_START_OTHER;
+			writeRec(ii);
+			continue;
+		}
+		t->state = REC_TIMER_PENDING;
+		wheelInsert(ii);
+	}
+	DBGLOG("%d recording timers loaded.", n);
+
+ bail:
+	UNLOCK_TIMERMUTEX();
+	return EngineSubmit(ENGINE_REC_TIMER, timerLoop, NULL);
+}
+
+/**
+ * Add a recording timer. A timer finished is dropped to make room if
+ * every slot is in use.
+ *
+ * @param req
+ *        start, duration, controls and file name format.
+ * @return
+ *        id of timer, -1 if refused.
+ */
+int
+TimerAdd( const rec_timer_t * req )
+{
+	unsigned int now = time(NULL);
+	int slot = NIL;
+	int id;
+	int ii;
+
+	if (!req->duration || (req->start + req->duration < req->start) ||
+		(req->start + req->duration <= now) ||
+		!memchr(req->path, 0, REC_TIMER_PATH) || !req->path[0])
+	{
+		WPRINT("recording timer refused.");
+		return -1;
+	}
+
+	LOCK_TIMERMUTEX();
+	for (ii = 0; ii < REC_TIMER_SLOTS; ii++)
+	{
+		if (!recs[ii].used)
+		{
+			slot = ii;
+			break;
+		}
+		// else the one finished first.
+		if (!waiting(recs[ii].t.state) && 
+			((slot == NIL) || (recs[ii].t.start < recs[slot].t.start)))
+			slot = ii;
+	}
+	if (slot == NIL)
+	{
+		UNLOCK_TIMERMUTEX();
+		WPRINT("recording timers all in use.");
+		return -1;
+	}
+
+	memset(&recs[slot], 0, sizeof(timer_rec_t));
+	recs[slot].used = 1;
+	recs[slot].t.id = ++lastId;
+	recs[slot].t.start = req->start;
+	recs[slot].t.duration = req->duration;
+	memcpy(&recs[slot].t.ctrl, &req->ctrl, sizeof(rec_ctrl_t));
+	strcpy(recs[slot].t.path, req->path);
+	recs[slot].t.state = REC_TIMER_PENDING;
+	created[slot] = 0;
+	owned[slot] = 0;
+	wheelInsert(slot);
+	writeRec(slot);
+	id = lastId;
+	UNLOCK_TIMERMUTEX();
+
+	DBGLOG("timer %d: %s at %u for %u s.", id, req->path, req->start, req->duration);
+	return id;
+}
+
+/**
+ * Remove a recording timer, stops the recording it started if still going.
+ *
+ * @param id
+ *        timer id.
+ * @return
+ *        0 if removed, -1 if no such timer.
+ */
+int
+TimerRemove( int id )
+{
+	rec_timer_t t;
+	unsigned int count;
+	int made;
+	int slot;
+
+	LOCK_TIMERMUTEX();
+	slot = findId(id);
+	if (slot == NIL)
+	{
+		UNLOCK_TIMERMUTEX();
+		return -1;
+	}
+	memcpy(&t, &recs[slot].t, sizeof(rec_timer_t));
+	if (waiting(t.state)) wheelRemove(slot);
+	made = created[slot] && (t.state != REC_TIMER_RECORDING);
+	count = owned[slot];
+	// an event being handled is undone by its handler.
+	if (slot == firing) made = count = 0;
+	created[slot] = 0;
+	memset(&recs[slot], 0, sizeof(timer_rec_t));
+	writeRec(slot);
+	UNLOCK_TIMERMUTEX();
+
+	if (t.state == REC_TIMER_RECORDING) finish(count);
+	if (made) discard(t.file);
+	return 0;
+}
+
+/**
+ * Get recording timers held.
+ *
+ * @param buf
+ *        timer buffer.
+ * @param max
+ *        timers buffer holds.
+ * @return
+ *        timers copied.
+ */
+int
+TimerGetAll( rec_timer_t * buf, int max )
+{
+	int n = 0;
+	int ii;
+
+	LOCK_TIMERMUTEX();
+	for (ii = 0; (ii < REC_TIMER_SLOTS) && (n < max); ii++)
+		if (recs[ii].used) memcpy(&buf[n++], &recs[ii].t, sizeof(rec_timer_t));
+	UNLOCK_TIMERMUTEX();
+	return n;
+}
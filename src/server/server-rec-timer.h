@@ -0,0 +1,44 @@
+#ifndef NMS_SERVER_REC_TIMER__H
+#define NMS_SERVER_REC_TIMER__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording timers header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define TIMER_FILE         "/mnt/OSD/.nms-rectimer"
+#define TIMER_WHEEL_SLOTS  64   // wheel turn, unit: second
+#define TIMER_PREWARM      5    // recording prepared ahead of start, unit: second
+#define TIMER_LATE_MS      40   // start later than a frame or so is logged.
+
+int  TimerInit(void);
+int  TimerAdd(const rec_timer_t *);
+int  TimerRemove(int);
+int  TimerGetAll(rec_timer_t *, int);
+
+#endif /* NMS_SERVER_REC_TIMER__H */
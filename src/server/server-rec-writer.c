@@ -0,0 +1,434 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording write-behind.
+ *
+ * Frames ready to commit are queued to a writer thread, which alone calls
+ * the encoder output plugin, so a slow file system write stalls only the
+ * writer. Queued frames are bounded by a memory budget, the mux waits 
+ * only once the budget is used up. Crossing the high water mark and 
+ * waiting on the budget are logged and counted. Finalization space the
+ * output plugin needs is published here after each commit, as tracked by
+ * the plugin interface, for the mux to read without taking a lock.
+ *
+ * A segment switch is queued between frames and run by the writer in 
+ * order; while it finishes one file and starts the next, the budget is 
+ * widened so the mux keeps going.
+ *
+ * Plugins that can flush their index while recording are asked to each 
+ * time what finalization needs grew by WRITER_FLUSH_FINALIZATION, so the 
+ * memory held for it stays bounded whatever the recording length.
+ *
+ * Frames from the capture queues are not copied, the writer takes their
+ * payload buffer and gives it back to the queue once committed. Frame 
+ * records are kept for reuse, so a settled recording allocates nothing.
+ *
+ * REVISION:
+ * 
+ * 7) Take queue payload buffers, reuse frame records. -- 2026-10-19
+ * 6) Time commits for recording statistics. ------------ 2026-10-19
+ * 5) Account commits for space reservation. ------------ 2026-10-19
+ * 4) Flush plugin index as finalization grows. --------- 2026-10-19
+ * 3) Run segment switches queued between frames. ------- 2026-10-19
+ * 2) Publish finalization requirement lock free. -------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "nmsplugin.h"
+#include "plugin-internals.h"
+#include "server-engine.h"
+#include "server-rec-queue.h"
+#include "server-rec-writer.h"
+#include "server-rec-prealloc.h"
+#include "server-rec-stats.h"
+
+typedef struct write_frame
+{
+	struct write_frame * next;
+	media_buf_t          buf;
+	int                  timeoffset;
+	writer_roll_t        roll;      // segment switch instead of a frame, if set.
+	int                  size;
+	rec_queue_t *        q;         // queue payload goes back to, NULL if a copy.
+	rec_payload_t        pay;
+} write_frame_t;
+
+static pthread_mutex_t    writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     writerCond = PTHREAD_COND_INITIALIZER;   // frame queued, or stop.
+static pthread_cond_t     spaceCond = PTHREAD_COND_INITIALIZER;    // frame written.
+static write_frame_t *    head;
+static write_frame_t *    tail;
+static write_frame_t *    spare;      // frame records kept for reuse.
+static int                quit;
+static int                drain;      // commit queued frames on stop.
+static int                failed;     // commit error, 0 if none.
+static int                high;       // above high water mark.
+static unsigned int       highMark;   // bytes, alarm above.
+static int                rolling;    // segment switches queued.
+static rec_writer_stats_t stats;
+static volatile unsigned int finalization; // bytes, as of last frame committed.
+static unsigned int       flushedAt;  // finalization after last flush.
+
+#define LOCK_WRITERMUTEX()   pthread_mutex_lock(&writerMutex)
+#define UNLOCK_WRITERMUTEX() pthread_mutex_unlock(&writerMutex)
+
+// bytes that may be queued, more while a segment switch is pending.
+static unsigned int limit( void )
+{
+	if (rolling && (stats.budget <= UINT_MAX / WRITER_ROLL_BUDGET))
+		return stats.budget * WRITER_ROLL_BUDGET;
+	return stats.budget;
+}
+
+// get a cleared frame record.
+static write_frame_t * frameGet( void )
+{
+	write_frame_t * f;
+
+	LOCK_WRITERMUTEX();
+	f = spare;
+	if (f) spare = f->next;
+	UNLOCK_WRITERMUTEX();
+
+	if (!f && !(f = malloc(sizeof(write_frame_t)))) return NULL;
+	memset(f, 0, sizeof(write_frame_t));
+	return f;
+}
+
+// give payload back and keep frame record, caller holds writerMutex.
+static void framePut( write_frame_t * f )
+{
+	if (f->q) RecQueueGiveBack(f->q, &f->pay);
+	else free(f->pay.data);
+	f->next = spare;
+	spare = f;
+}
+
+static void * writerLoop( void * arg )
+{
+	write_frame_t * f;
+	int ret;
+
+	while (1)
+	{
+		LOCK_WRITERMUTEX();
+		while (!head && !quit)
+			pthread_cond_wait(&writerCond, &writerMutex);
+		f = head;
+		if (!f || (quit && (!drain || failed)))
+		{
+			UNLOCK_WRITERMUTEX();
+			break;
+		}
+		UNLOCK_WRITERMUTEX();
+
+		// file system may stall here, nothing else waits on it.
+		if (failed) ret = 0;
+		else if (f->roll) ret = f->roll();
+		else
+		{
+			struct timeval start, now;
+
+			gettimeofday(&start, NULL);
+			ret = EncOutputCommit(&f->buf, f->timeoffset);
+			gettimeofday(&now, NULL);
+			if (!ret)
+				StatsCommitted(f->buf.curbuf == &f->buf.abuf, f->size,
+							   (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_usec - start.tv_usec));
+		}
+		if (!ret)
+		{
+			encoding_requirements_t req;
+
+			EncOutputTrackedRequirements(&req);
+			if (!f->roll) PreallocCommitted(f->size);
+			if (f->roll) flushedAt = 0;
+			else if ((req.finalization >= flushedAt + WRITER_FLUSH_FINALIZATION) && EncOutputCanFlush())
+			{
+				ret = EncOutputFlush();
+				EncOutputTrackedRequirements(&req);
+				flushedAt = req.finalization;
+				LOCK_WRITERMUTEX();
+				stats.flushes++;
+				UNLOCK_WRITERMUTEX();
+			}
+			finalization = req.finalization;
+		}
+
+		LOCK_WRITERMUTEX();
+		if (ret && !failed)
+		{
+			WPRINT("Data commit error (%d).", ret);
+			failed = ret;
+		}
+		head = f->next;
+		if (!head) tail = NULL;
+		stats.bytes -= f->size;
+		if (f->roll) rolling--;
+		else stats.frames++;
+		if (high && (stats.bytes < highMark / 2))
+			high = 0;
+		framePut(f);
+		UNLOCK_WRITERMUTEX();
+		pthread_cond_broadcast(&spaceCond);
+	}
+
+	// drop whatever is left.
+	LOCK_WRITERMUTEX();
+	while (head)
+	{
+		f = head;
+		head = f->next;
+		stats.bytes -= f->size;
+		framePut(f);
+	}
+	tail = NULL;
+	UNLOCK_WRITERMUTEX();
+	pthread_cond_broadcast(&spaceCond);
+	return NULL;
+}
+
+/**
+ * Start writer for a new recording.
+ *
+ * @param budget
+ *        bytes that may be queued, 0 for default.
+ * @return
+ *        0 if writer started.
+ */
+int
+WriterStart( unsigned int budget )
+{
+	encoding_requirements_t req;
+
+	if (!budget) budget = WRITER_BUDGET_DEFAULT;
+	if (budget < WRITER_BUDGET_MIN) budget = WRITER_BUDGET_MIN;
+
+	LOCK_WRITERMUTEX();
+	head = tail = NULL;
+	quit = drain = failed = high = rolling = 0;
+	memset(&stats, 0, sizeof(rec_writer_stats_t));
+	stats.budget = budget;
+	highMark = budget / 100 * WRITER_HIGH_WATER;
+	EncOutputTrackedRequirements(&req);
+	finalization = req.finalization;
+	flushedAt = 0;
+	UNLOCK_WRITERMUTEX();
+
+	return EngineSubmit(ENGINE_REC_WRITER, writerLoop, NULL);
+}
+
+/**
+ * Queue a frame to be committed, waits if the budget is used up.
+ *
+ * @param buf
+ *        frame, curbuf set to the stream buffer.
+ * @param q
+ *        queue buf is the oldest frame of, its payload buffer is taken. 
+ *        NULL to queue a copy.
+ * @param timeoffset
+ *        passed to commit.
+ * @param stalled
+ *        set nonzero if frame had to wait for budget.
+ * @return
+ *        0 if queued, otherwise commit error of an earlier frame; the
+ *        recording can not go on.
+ */
+int
+WriterPush( const media_buf_t * buf, rec_queue_t * q, int timeoffset, int * stalled )
+{
+	write_frame_t * f;
+	int size = buf->curbuf->size;
+	int ret;
+
+	*stalled = 0;
+	if (size < 0) size = 0;
+
+	f = frameGet();
+	if (!f) return -1;
+	if (q) RecQueueTake(q, &f->pay);
+	else if (size)
+	{
+		f->pay.data = malloc(size);
+		if (!f->pay.data)
+		{
+			LOCK_WRITERMUTEX();
+			framePut(f);
+			UNLOCK_WRITERMUTEX();
+			return -1;
+		}
+		f->pay.cap = size;
+		memcpy(f->pay.data, buf->curbuf->data, size);
+	}
+	f->q = q;
+	memcpy(&f->buf, buf, sizeof(media_buf_t));
+	f->timeoffset = timeoffset;
+	f->size = size;
+	f->buf.curbuf = (buf->curbuf == &buf->abuf)? &f->buf.abuf : &f->buf.vbuf;
+	f->buf.curbuf->data = f->pay.data;
+
+	LOCK_WRITERMUTEX();
+	// a frame larger than the budget goes alone.
+	if (!failed && stats.bytes && (stats.bytes + size > limit()))
+	{
+		struct timeval start, now;
+		unsigned int ms;
+
+		gettimeofday(&start, NULL);
+		while (!failed && stats.bytes && (stats.bytes + size > limit()))
+			pthread_cond_wait(&spaceCond, &writerMutex);
+		gettimeofday(&now, NULL);
+
+		ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+		stats.stalls++;
+		stats.stallMs += ms;
+		*stalled = 1;
+		WARNLOG("write-behind budget used up, waited %u ms.", ms);
+	}
+
+	ret = failed;
+	if (ret)
+	{
+		framePut(f);
+		UNLOCK_WRITERMUTEX();
+		return ret;
+	}
+
+	if (tail) tail->next = f;
+	else head = f;
+	tail = f;
+	stats.bytes += size;
+	if (stats.bytes > stats.peak) stats.peak = stats.bytes;
+	if (!high && (stats.bytes > highMark))
+	{
+		high = 1;
+		stats.highWater++;
+		WPRINT("write-behind above high water, %u of %u bytes queued.", 
+			   stats.bytes, stats.budget);
+	}
+	UNLOCK_WRITERMUTEX();
+
+	pthread_cond_signal(&writerCond);
+	return 0;
+}
+
+/**
+ * Queue a segment switch, run by the writer once frames queued before it
+ * are committed.
+ *
+ * @param roll
+ *        switch function, returns nonzero if the recording can not go on.
+ * @return
+ *        0 if queued, otherwise commit error of an earlier frame.
+ */
+int
+WriterPushRollover( writer_roll_t roll )
+{
+	write_frame_t * f;
+	int ret;
+
+	f = frameGet();
+	if (!f) return -1;
+	f->roll = roll;
+
+	LOCK_WRITERMUTEX();
+	ret = failed;
+	if (ret)
+	{
+		framePut(f);
+		UNLOCK_WRITERMUTEX();
+		return ret;
+	}
+	if (tail) tail->next = f;
+	else head = f;
+	tail = f;
+	rolling++;
+	UNLOCK_WRITERMUTEX();
+
+	pthread_cond_signal(&writerCond);
+	return 0;
+}
+
+/**
+ * Stop writer and wait till it is done.
+ *
+ * @param commit
+ *        nonzero to commit queued frames first, otherwise drop them.
+ * @return
+ *        commit error, 0 if every frame was committed.
+ */
+int
+WriterStop( int commit )
+{
+	int ret;
+
+	LOCK_WRITERMUTEX();
+	quit = 1;
+	drain = commit;
+	UNLOCK_WRITERMUTEX();
+	pthread_cond_broadcast(&writerCond);
+
+	EngineWait(ENGINE_REC_WRITER);
+
+	LOCK_WRITERMUTEX();
+	ret = failed;
+	UNLOCK_WRITERMUTEX();
+	return ret;
+}
+
+/**
+ * Get space output plugin needs to finalize, as of the last frame committed.
+ *
+ * @return
+ *        bytes needed.
+ */
+unsigned int
+WriterGetFinalization( void )
+{
+	return finalization;
+}
+
+/**
+ * Get write-behind statistics of current or last recording.
+ *
+ * @param s
+ *        statistics buffer.
+ */
+void
+WriterGetStats( rec_writer_stats_t * s )
+{
+	LOCK_WRITERMUTEX();
+	memcpy(s, &stats, sizeof(rec_writer_stats_t));
+	UNLOCK_WRITERMUTEX();
+}
@@ -0,0 +1,52 @@
+#ifndef NMS_SERVER_REC_WRITER__H
+#define NMS_SERVER_REC_WRITER__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms recording write-behind header.
+ *
+ * REVISION:
+ * 
+ * 5) Take payload buffer of queued frames. -------------- 2026-10-19
+ * 4) Added index flush threshold. ----------------------- 2026-10-19
+ * 3) Added segment switch. ------------------------------ 2026-10-19
+ * 2) Read finalization requirement lock free. ----------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define WRITER_BUDGET_DEFAULT  (2 * 1024 * 1024)  // bytes queued at most.
+#define WRITER_BUDGET_MIN      (256 * 1024)
+#define WRITER_HIGH_WATER      75                 // alarm above, percent of budget.
+#define WRITER_ROLL_BUDGET     8                  // budget multiple while switching segment.
+#define WRITER_FLUSH_FINALIZATION (1024 * 1024)   // finalization growth that triggers index flush.
+
+typedef int (*writer_roll_t)(void);
+
+int  WriterStart(unsigned int);
+unsigned int WriterGetFinalization(void);
+int  WriterPush(const media_buf_t *, rec_queue_t *, int, int *);
+int  WriterPushRollover(writer_roll_t);
+int  WriterStop(int);
+void WriterGetStats(rec_writer_stats_t *);
+
+#endif /* NMS_SERVER_REC_WRITER__H */
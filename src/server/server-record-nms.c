@@ -24,6 +24,20 @@
  *
  * REVISION:
  * 
+ * 18) Recorder control lock for start and stop. -------- 2026-10-19
+ * 17) Writer takes queued frame payloads, no copy. ----- 2026-10-19
+ * 16) Count recordings started. ------------------------ 2026-10-19
+ * 15) Start recordings with monitor pre-roll. ---------- 2026-10-19
+ * 14) Count recording statistics. ---------------------- 2026-10-19
+ * 13) Reserve disk space ahead of writes. -------------- 2026-10-19
+ * 12) Bound finalization by segment length. ------------ 2026-10-19
+ * 11) Cut long recordings in segments. ----------------- 2026-10-19
+ * 10) Read tracked finalization requirement. ----------- 2026-10-19
+ * 9) Free space refreshed by background monitor. ------- 2026-10-19
+ * 8) Commit frames through write-behind writer. -------- 2026-10-19
+ * 7) Capture streams queue frames to a mux thread. ----- 2026-10-19
+ * 6) Scheduling from the per-role policy table. -------- 2026-10-19
+ * 5) Run a/v loops on persistent engine threads. ------- 2026-10-19
  * 4) Cleaned up mutex usage. ----------------------------- 2007-12-14 MG
  * 3) new experimental sync algorithm. -------------------- 2007-03-20 MG
  * 2) Split a/v to its own thread. ------------------------ 2006-04-13 MG
@@ -34,8 +48,11 @@
 #include <pthread.h>
 #include <sched.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/statvfs.h>
+#include <sys/time.h>
+#include <semaphore.h>
 
 #define CL_HACK 
 /* the second audio timestamp is too bigger than first.
@@ -52,14 +69,17 @@
 #include "server-nms.h"
 #include "nmsplugin.h"
 #include "plugin-internals.h"
+#include "server-engine.h"
+#include "server-sched.h"
+#include "server-rec-queue.h"
+#include "server-rec-writer.h"
+#include "server-rec-space.h"
+#include "server-rec-segment.h"
+#include "server-rec-prealloc.h"
+#include "server-rec-stats.h"
+#include "server-rec-preroll.h"
 
 #define PID_LEN 10
-#define ENC_AUDIO_THREAD_PRIORITY 99 //may need the highest priority
-#define PASSTHRU_PIP_RESIZE_THREAD_PRIORITY 90
-#define IRESIZE_THREAD_PRIORITY 80 // must higher than nmsd thread priority(1) and lower 
-																			// than encode audio thread priority(99)
-#define IDMATF_THREAD_PRIORITY 80 // must higher than nmsd thread priority(1) and lower
-																			// than encode audio thread priority(99)
 #define PROC_IDMATF_PID "/proc/ingenient/imanage/idmatf_pid"
 #define PROC_IRESIZE_PID "/proc/ingenient/ividio/iresize_pid"
 #define PROC_AUDIO_ENC_PID "/proc/ingenient/iencode/audio_enc_pid"
@@ -90,11 +110,14 @@ static int                going;
 static NMS_SRV_ERROR_DETAIL lastRecErrorDetail;
 
 static media_desc_t       mdesc;
-static media_buf_t        mbuf;
 
 /*
  * Recording finalization is using too much memory with low quality sometimes and the system crash
  * due to out of memory. So limit the maximum of recording length to hack it for now.
+ * Recordings are cut in segments of SEGMENT_LENGTH at a key frame, this only applies to a 
+ * segment that found no key frame in time. Plugins that flush their index while recording
+ * keep finalization small, see server-rec-writer.c; with others a segment is also cut once
+ * finalization grows past SEGMENT_FINALIZATION.
 */
 #define MAX_LENGTH (4 * 60 * 60) // 4hours
 
@@ -107,19 +130,27 @@ static int     atsms = 0;
 static int     adelta = 0;
 #endif
 
-/* Used for initial and ongoing free space checks */
+/* Used for initial and ongoing free space checks, refreshed by space monitor. */
 static unsigned long long diskFreeSpace;
-static unsigned int       recordingSize;
+static unsigned long long recordingSize;  // all segments.
+static unsigned int       segmentSize;    // current segment.
+static int                segmentStart;   // time stamp current segment started at.
+static int                outputFinished; // plugin finished by a failed segment switch.
+static rec_ctrl_t         segCtrl;        // parameters of next segments.
 //static unsigned int       initialScratchReq;
 static encoding_requirements_t requirements;
-#define FILE_SIZE_LIMIT  ((unsigned int)-1) //around 4Gb
+static unsigned int       writerBudget; // 0 for default.
+static unsigned int       recordings;   // started, tells one recording from the next.
+#define FILE_SIZE_LIMIT  ((unsigned int)-1) //around 4Gb, per segment
+
+// capture threads queue frames, mux thread alone commits them.
+static rec_queue_t        audQueue;
+static rec_queue_t        vidQueue;
+static sem_t              muxSem;    // posted for every frame queued, and on stop.
+static int                muxSemInited;
+#define QUEUE_FULL_TICK   5000       // capture back off while mux catches up, unit: micro-second
 
-static int                audReady;
-static int                vidReady;
-static pthread_t          audThread = (pthread_t)NULL;
-static pthread_t          vidThread = (pthread_t)NULL;
 static pthread_mutex_t    recordMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t     recordCond  = PTHREAD_COND_INITIALIZER;
 
 #define LOCK_RMUTEX()  do {							\
 		pthread_mutex_lock(&recordMutex);			\
@@ -128,6 +159,9 @@ static pthread_cond_t     recordCond  = PTHREAD_COND_INITIALIZER;
 		pthread_mutex_unlock(&recordMutex);		\
 	}while(0)
 
+// held by whoever starts, pauses or stops the recorder or the monitor.
+static pthread_mutex_t    controlMutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /*
 Perform various disk-related checks before committing a frame of size commitSize to disk.
@@ -135,9 +169,9 @@ All these tests perform only a few arithmetical operations, and don't call any s
 do I/O, so they should be quite lightweigth to perform even at each frame commit.
 
 0 = we can go on recording
-1 = we will break the 4Gb barrier if we don't stop recording now.
+1 = we will break the 4Gb barrier if we don't start a new segment now.
 2 = we will not be able to finalize due to insufficient disk space if we don't stop recording now.
-3 = we will break the 4 HOURS barrier if we don't stop recording now. 
+3 = we will break the 4 HOURS barrier if we don't start a new segment now. 
 */
 #ifdef DEBUG_RESERVE
 static unsigned int reserve_dbg_count = 0;
@@ -146,28 +180,105 @@ static int preCommitChecks(unsigned int commitSize)
 {
 	int ret = 0;
 
-	//Update requirements to match current recording status. This operation should be inexpensive.
-	EncOutputGetRequirements(&requirements);
+	//Update requirements to match current recording status. Tracked by the writer as it commits,
+	//this is a plain read.
+	requirements.finalization = WriterGetFinalization();
+	// Free space is sampled in background, this only reads the last figure.
+	diskFreeSpace = SpaceGetBudget();
 
 #ifdef DEBUG_RESERVE
-	if (reserve_dbg_count++ % 1000 == 0) DBGLOG("finalization = %u, to_filemax: %u, size: %u\n", requirements.finalization, FILE_SIZE_LIMIT - requirements.finalization, recordingSize);
+	if (reserve_dbg_count++ % 1000 == 0) DBGLOG("finalization = %u, to_filemax: %u, size: %llu\n", requirements.finalization, FILE_SIZE_LIMIT - requirements.finalization, recordingSize);
 #endif
 
 	// ** First test (4Gb limit).
 	// Question: would we be able to finalize this file keeping it under 4Gb, if we were to finalize after committing ?
-	if (recordingSize >= FILE_SIZE_LIMIT - (requirements.finalization + commitSize))
+	if ((unsigned long long)segmentSize + requirements.finalization + commitSize >= FILE_SIZE_LIMIT)
 		ret = 1;
 	
 	// ** Second test (free disk space).
 	// Question: would we have enough disk space to finalize this file, if we were to finalize after committing ?
-	else if (recordingSize >= diskFreeSpace - (requirements.finalization + commitSize))
+	else if (recordingSize + requirements.finalization + commitSize >= diskFreeSpace)
 		ret = 2;
-	else if ((timestamp / 1000) > MAX_LENGTH)
+	else if (((timestamp - segmentStart) / 1000) > MAX_LENGTH)
 		ret = 3;
 	
 	return ret;
 }
 
+// Segment is due once close to its limits, it starts at the next key frame.
+static int segmentDue(void)
+{
+	unsigned long long left = (unsigned long long)requirements.finalization + SEGMENT_KEY_MARGIN;
+
+	if ((unsigned long long)segmentSize + left >= FILE_SIZE_LIMIT)
+		return 1;
+	if (requirements.finalization >= SEGMENT_FINALIZATION)
+		return 1;
+	return ((timestamp - segmentStart) / 1000) >= SEGMENT_LENGTH;
+}
+
+// frame a segment may start with.
+static int is_key_frame(media_buf_t * mbuf, int audio)
+{
+	if (audio) return (mdesc.vdesc.video_type == NMS_VC_NO_VIDEO);
+	return SegmentIsKeyFrame(mdesc.vdesc.video_type, mbuf->curbuf->data, mbuf->curbuf->size);
+}
+
+// bit rate to reserve disk space for, unit: kbit/s
+static unsigned int expected_kbps(const media_desc_t * desc)
+{
+	unsigned int kbps = 0;
+
+	if (desc->vdesc.video_type != NMS_VC_NO_VIDEO) kbps += desc->vdesc.bitrate;
+	if (desc->adesc.audio_type != NMS_AC_NO_AUDIO) kbps += PREALLOC_AUDIO_KBPS;
+	return kbps;
+}
+
+// switch plugin over to the next segment, run by the writer between frames.
+static int roll_segment(void)
+{
+	char path[PATH_MAX];
+	media_desc_t desc;
+	int ret;
+
+	if (SegmentNext(path, sizeof(path)))
+	{
+		WPRINT("Next segment not prepared.");
+		return -1;
+	}
+	DBGLOG("Switching to segment: %s", path);
+
+	ret = EncOutputFinish();
+	if (ret) WPRINT("Segment finalization error (%d).", ret);
+	PreallocStop();
+
+	ret = -1;
+	memset(&desc, 0, sizeof(media_desc_t));
+	if (EncOutputIsOurFormat(&segCtrl, path, &desc))
+	{
+		desc.vdesc.capture_port = segCtrl.is_pal;
+		ret = EncOutputInit(&desc);
+		if (!ret)
+		{
+			ret = EncOutputStart();
+			if (ret) EncOutputFinish();
+		}
+	}
+	if (ret)
+	{
+		WPRINT("Unable to start segment %s (%d).", path, ret);
+		LOCK_RMUTEX();
+		outputFinished = 1;
+		UNLOCK_RMUTEX();
+		return ret;
+	}
+
+	PreallocStart(path, expected_kbps(&desc));
+	SegmentSwitched();
+	return 0;
+}
+
+// finish plugins, once per recording.
 static void stop_server(void)
 {
 	LOCK_RMUTEX();
@@ -177,51 +288,43 @@ static void stop_server(void)
 		return;
 	}
 
-	DBGLOG("Stopping server. Current size: %u\n", recordingSize);
-	if (mdesc.adesc.audio_type == NMS_AC_NO_AUDIO)
-	{
-		stopped = RECORDER_STOPPED;
-		EncInputFinish();
-		EncOutputFinish();
-	}
-	else
-	{
-		DBGLOG("stopping interface.");
-
-	    if (RECORDER_AV_STOP == stopped)
-		  {
-			DBGLOG("interface stopped.");
-			stopped = RECORDER_STOPPED;
-			EncInputFinish();
-			// TODO: The exit status of this is pretty important to report MP4 errors, so we need to send it out somehow.
-			//       most likely with the same system as lastRecErrorDetail.
-			EncOutputFinish();
-		  }
-	}
+	DBGLOG("Stopping server. Current size: %llu\n", recordingSize);
+	stopped = RECORDER_STOPPED;
+	EncInputFinish();
+	// TODO: The exit status of this is pretty important to report MP4 errors, so we need to send it out somehow.
+	//       most likely with the same system as lastRecErrorDetail.
+	if (!outputFinished) EncOutputFinish();
+	PreallocStop();
 	UNLOCK_RMUTEX();
+}
 
-	pthread_cond_broadcast(&recordCond);
+// record commit error, writer reports them late.
+static void commit_failed(int commitret)
+{
+	LOCK_RMUTEX();
+	if (commitret == KNOWNERR_MAX_FRAMES_LIMIT) lastRecErrorDetail.error = NMS_RECORD_FRAME_LIMIT; 
+	else lastRecErrorDetail.error = NMS_RECORD_OTHER_COMMIT_ERROR;
+	lastRecErrorDetail.source = SRC_PLUG_OUT_COMMIT;
+	lastRecErrorDetail.message = commitret;
+	going = 0;
+	UNLOCK_RMUTEX();
 }
 
-static int avsync_save_frame(void)
+// commit a frame the mux picked, audio frame if audio is set. The
+// writer takes the payload of q's oldest frame, mbuf is copied if no q.
+static int avsync_save_frame(media_buf_t * mbuf, int audio, rec_queue_t * q)
 {
 	BOOL save_audio_frame = FALSE;
-	BOOL save_video_frame = FALSE;
 	BOOL update_time_stamp = FALSE;
+	BOOL commit = FALSE;
+	BOOL roll = FALSE;
+	int loc_timeoffset = 0;
 	int status = 0;
 
 #ifdef LOG_EACH_FRAME
 	DBGLOG("entering avsync frame.");
 #endif
 	LOCK_RMUTEX();
-	if (mdesc.adesc.audio_type != NMS_AC_NO_AUDIO)
-	{
-		if ((!audReady || !vidReady))
-		{
-			WPRINT("a/v not ready yet.");
-			goto out;
-		}
-	}
 	if (mdesc.vdesc.video_type == NMS_VC_NO_VIDEO)
 	{
 		// audio only.
@@ -229,7 +332,7 @@ static int avsync_save_frame(void)
 		DBGLOG("save audio only frame.");
 #endif
 		save_audio_frame = TRUE;
-		mbuf.curbuf = &mbuf.abuf;
+		mbuf->curbuf = &mbuf->abuf;
 		update_time_stamp = TRUE;
 	}
 	else if (mdesc.adesc.audio_type == NMS_AC_NO_AUDIO)
@@ -237,42 +340,42 @@ static int avsync_save_frame(void)
 #ifdef LOG_EACH_FRAME
 		DBGLOG("save video only frame.");
 #endif
-		save_video_frame = TRUE;
-		mbuf.curbuf = &mbuf.vbuf;
+		mbuf->curbuf = &mbuf->vbuf;
 		update_time_stamp = TRUE;
 	}
 	else
 	{
-		if (mbuf.abuf.tsms <= mbuf.vbuf.tsms)
+		// mux has already ordered frames by time stamp.
+		if (audio)
 		{
 #ifdef LOG_EACH_FRAME
 			DBGLOG("avsync save audio frame.");
 #endif
 			save_audio_frame = TRUE;
-			mbuf.curbuf = &mbuf.abuf;
+			mbuf->curbuf = &mbuf->abuf;
 #ifdef CL_HACK
 			int tsmsTemp = 0;
 			if (anumber > 1)
 			{
-				mbuf.curbuf->tsms -= adelta;
+				mbuf->curbuf->tsms -= adelta;
 			}
 			else if (anumber == 1)
 			{
 				tsmsTemp = atsms + (SAMPLE_RATE * TSMS_INCREMENT) / mdesc.adesc.sample_rate;
-				adelta = mbuf.curbuf->tsms - tsmsTemp;
-				mbuf.curbuf->tsms = tsmsTemp;
+				adelta = mbuf->curbuf->tsms - tsmsTemp;
+				mbuf->curbuf->tsms = tsmsTemp;
 				anumber = 2;
 			}
 			else
 			{
-				atsms = mbuf.curbuf->tsms;
+				atsms = mbuf->curbuf->tsms;
 				anumber = 1;
 			}
             
 			// keep async
 			tsmsTemp = (AV_SYNC * SAMPLE_RATE) / mdesc.adesc.sample_rate;
-			if (mbuf.curbuf->tsms > tsmsTemp)
-				mbuf.curbuf->tsms -= tsmsTemp;
+			if (mbuf->curbuf->tsms > tsmsTemp)
+				mbuf->curbuf->tsms -= tsmsTemp;
 #endif			
 		}
 		else
@@ -280,8 +383,7 @@ static int avsync_save_frame(void)
 #ifdef LOG_EACH_FRAME
 			DBGLOG("avsync save video frame.");
 #endif
-			save_video_frame = TRUE;
-			mbuf.curbuf = &mbuf.vbuf;
+			mbuf->curbuf = &mbuf->vbuf;
 			update_time_stamp = TRUE;
 		}
 	}
@@ -289,12 +391,12 @@ static int avsync_save_frame(void)
 	// track time difference between paused state change.
 	if (RECORDER_TO_PAUSE == paused)
 	{
-		timeoffset -= mbuf.curbuf->tsms;
+		timeoffset -= mbuf->curbuf->tsms;
 		paused = RECORDER_PAUSE;
 	}
 	else if (RECORDER_TO_UNPAUSE == paused)
 	{
-		timeoffset += mbuf.curbuf->tsms;
+		timeoffset += mbuf->curbuf->tsms;
 		paused = RECORDER_UNPAUSE;
 	}
 	
@@ -303,10 +405,21 @@ static int avsync_save_frame(void)
 		// Before committing this frame, check if committing it would go over any disk space limits or file size limits.
 		// Stop the recording cleanly if that happens and return a meaningful error so that recorder can handle correctly.
 		
-		int check = preCommitChecks(mbuf.curbuf->size);
+		int check = preCommitChecks(mbuf->curbuf->size);
+
+		// Segments are cut at a key frame once due, hitting a limit first cuts at any frame.
+		if ((check == 1) || (check == 3))
+		{
+			WPRINT("No key frame before segment limit (%d), cutting here.", check);
+			roll = TRUE;
+			check = 0;
+		}
+		else if ((check == 0) && segmentDue() && is_key_frame(mbuf, save_audio_frame))
+			roll = TRUE;
+
 		if (check != 0) 
 		{
-			DBGLOG("Pre-commit check exit with value %d. Current recordingSize: %u\n", check, recordingSize);
+			DBGLOG("Pre-commit check exit with value %d. Current recordingSize: %llu\n", check, recordingSize);
 			
 			lastRecErrorDetail.source = SRC_SERVER_RECPRECOMMIT;
 			if (check == 1) lastRecErrorDetail.error = NMS_RECORD_FILE_SIZE; //we should finalize now or exceed 4GB file size
@@ -320,257 +433,223 @@ static int avsync_save_frame(void)
 			goto bail;
 		}
 		
-		recordingSize += mbuf.curbuf->size;
-		mbuf.curbuf->tsms -= timeoffset;
-		
-		int commitret = EncOutputCommit(&mbuf, timeoffset);
-		if (commitret)
+		mbuf->curbuf->tsms -= timeoffset;
+		if (roll)
 		{
-			WPRINT("Data commit error (%d).", commitret);
-			
-			if (commitret == KNOWNERR_MAX_FRAMES_LIMIT) lastRecErrorDetail.error = NMS_RECORD_FRAME_LIMIT; 
-			else lastRecErrorDetail.error = NMS_RECORD_OTHER_COMMIT_ERROR;
-			lastRecErrorDetail.source = SRC_PLUG_OUT_COMMIT;
-			lastRecErrorDetail.message = commitret;
-			
-			status = -1;
-			going = 0;
-			goto bail;
+			SegmentEnd(mbuf->curbuf->tsms - segmentStart);
+			segmentStart = mbuf->curbuf->tsms;
+			segmentSize = 0;
 		}
-		if (update_time_stamp) timestamp = mbuf.curbuf->tsms;
+		recordingSize += mbuf->curbuf->size;
+		segmentSize += mbuf->curbuf->size;
+		
+		// committed by the writer, out of the lock.
+		commit = TRUE;
+		loc_timeoffset = timeoffset;
+		if (update_time_stamp) timestamp = mbuf->curbuf->tsms;
+
+		// each segment starts at time zero.
+		if (mbuf->curbuf->tsms > segmentStart) mbuf->curbuf->tsms -= segmentStart;
+		else mbuf->curbuf->tsms = 0;
 	}
  bail:
-    if (save_audio_frame == TRUE)
-	{
-		EncInputPutBuffer(1, &mbuf); 
-		audReady = 0;
-	}
-    else if (save_video_frame == TRUE)
-	{
-		EncInputPutBuffer(0, &mbuf);
-		vidReady = 0;
-	}
-	
 #ifdef LOG_TIME_STAMP__
 	if (save_audio_frame == TRUE)
-		DBGLOG("   aT = %d\n", mbuf.curbuf->tsms);
+		DBGLOG("   aT = %d\n", mbuf->curbuf->tsms);
 	else
-		DBGLOG("---vT = %d\n", mbuf.curbuf->tsms);
+		DBGLOG("---vT = %d\n", mbuf->curbuf->tsms);
 #endif
 	
- out:
 #ifdef LOG_EACH_FRAME
 	DBGLOG("leaving avsync frame.");
 #endif
     UNLOCK_RMUTEX();
-    pthread_cond_broadcast(&recordCond);
-	return status;
-}
 
-static void * audLoop( void * arg )
-{
-	struct sched_param nmsd_param;
+	if (commit)
+	{
+		int stalled = 0;
+		int commitret = roll? WriterPushRollover(roll_segment) : 0;
 
-	sched_getparam(0, &nmsd_param);
-	nmsd_param.sched_priority=1;
-	sched_setscheduler(0,SCHED_RR,&nmsd_param);
-	while (1)
-	  {
-#ifdef LOG_EACH_FRAME
-		DBGLOG("audio encode thread.");
-#endif
-		LOCK_RMUTEX();
-		if (audReady)
-		{
-			// Wait till previous audio framed is saved.
-			while (audReady && going)
-			{
-#ifdef LOG_EACH_FRAME
-				DBGLOG("audio thread waiting...");
-#endif
-				pthread_cond_wait(&recordCond, &recordMutex);
-			}
-		}
-#ifdef LOG_EACH_FRAME
-		DBGLOG("audio thread check point.");
-#endif
+		if (!commitret) commitret = WriterPush(mbuf, q, loc_timeoffset, &stalled);
 
-		if (!going)
+		if (commitret)
 		{
-			UNLOCK_RMUTEX();
-			break;
+			commit_failed(commitret);
+			status = -1;
 		}
-		UNLOCK_RMUTEX();
-
-#ifdef LOG_EACH_FRAME
-		DBGLOG("get audio buffer.");
-#endif
-		// do not need to protect mbuf because EncInputGetBuffer only
-		// operates on either audio or video buffer.
-		if ( 0 != EncInputGetBuffer(1, &mbuf, 100))
+		else if (stalled)
 		{
-			WPRINT("audio buffer empty!");
-			continue;
+			// capture may have dropped frames meanwhile, let the client know.
+			LOCK_RMUTEX();
+			if (lastRecErrorDetail.error == NMS_RECORD_OK)
+			{
+				lastRecErrorDetail.source = SRC_SERVER_RECWRITER;
+				lastRecErrorDetail.message++;
+			}
+			UNLOCK_RMUTEX();
 		}
+	}
+	return status;
+}
 
-		LOCK_RMUTEX();
-		audReady = 1;
-		UNLOCK_RMUTEX();
-
-		if (avsync_save_frame()) break;
-	  }
+static int is_going(void)
+{
+	int loc_going;
 
-	DBGLOG("audio thread exiting.");
 	LOCK_RMUTEX();
-	audReady = 0;
-	stopped |= RECORDER_AUDIO_STOP;
+	loc_going = going;
 	UNLOCK_RMUTEX();
-	DBGLOG("audio thread exited.");
-	
-	stop_server();
-	pthread_exit(NULL);
+	return loc_going;
 }
 
-static void * vidLoop( void * arg )
+// capture loop of one stream, never waits for the other stream.
+static void capture_loop(rec_queue_t * q)
 {
-	struct sched_param nmsd_param;
+	media_buf_t buf;
+	int av = q->audio;
+	int ret;
 
-	sched_getparam(0, &nmsd_param);
-	nmsd_param.sched_priority=1;
-	sched_setscheduler(0,SCHED_RR,&nmsd_param);
-	while (1)
+	// scheduling is applied once by the engine thread, see server-sched.c.
+	while (is_going())
 	{
 #ifdef LOG_EACH_FRAME
-		DBGLOG("video encode thread.");
+		DBGLOG("%s encode thread.", av? "audio" : "video");
 #endif
-		
-		LOCK_RMUTEX();
-		if (vidReady)
+		if ( 0 != EncInputGetBuffer(av, &buf, 100))
 		{
-			// Wait till previous audio framed is saved.
-			while (vidReady && going)
-			{
-#ifdef LOG_EACH_FRAME
-				DBGLOG("video thread waiting...");
+#ifndef LOG_EACH_FRAME
+			if (av)
 #endif
-				pthread_cond_wait(&recordCond, &recordMutex);
-			}
+			WPRINT("%s buffer empty!", av? "audio" : "video");
+			StatsTimeout(av);
+			continue;
 		}
-#ifdef LOG_EACH_FRAME
-		DBGLOG("video thread check point.");
-#endif
-		
-		if (!going)
+
+		// mux is behind, hold on to the frame rather than drop it.
+		if (1 == (ret = RecQueuePush(q, &buf)))
 		{
-			UNLOCK_RMUTEX();
-			break;
+			struct timeval start, now;
+
+			gettimeofday(&start, NULL);
+			while ((1 == (ret = RecQueuePush(q, &buf))) && is_going())
+				usleep(QUEUE_FULL_TICK);
+			gettimeofday(&now, NULL);
+			StatsQueueFull(av, (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000);
 		}
-		UNLOCK_RMUTEX();
-		
-#ifdef LOG_EACH_FRAME
-		DBGLOG("get video buffer.");
-#endif
-		if ( 0 != EncInputGetBuffer(0, &mbuf, 100))
+		EncInputPutBuffer(av, &buf);
+
+		if (ret == 0)
 		{
-#ifdef LOG_EACH_FRAME
-			WPRINT("video buffer empty!");
-#endif
-			continue;
+			StatsCaptured(av, RecQueueCount(q));
+			sem_post(&muxSem);
+		}
+		else if (ret < 0)
+		{
+			WPRINT("%s frame dropped, out of memory.", av? "audio" : "video");
+			StatsDropped(av);
 		}
-		
-		LOCK_RMUTEX();
-		vidReady = 1;
-		UNLOCK_RMUTEX();
-		if (avsync_save_frame()) break;
 	}
-	
-	DBGLOG("video thread exiting.");
-	LOCK_RMUTEX();
-	vidReady = 0;
-	stopped |= RECORDER_VIDEO_STOP;
-	UNLOCK_RMUTEX();
-	DBGLOG("video thread exited.");
+	DBGLOG("%s thread exited.", av? "audio" : "video");
+}
 
-	stop_server();
-	pthread_exit(NULL);
+static void * audLoop( void * arg )
+{
+	capture_loop(&audQueue);
+	return NULL;
 }
 
-static void revert_imedia_thread_prio(void)
+static void * vidLoop( void * arg )
 {
-	int pid;
-	char buf[PID_LEN];
-	struct sched_param nmsd_param;
-	int fd=-1;
-	if (mdesc.vdesc.video_type != NMS_AC_NO_AUDIO)
+	capture_loop(&vidQueue);
+	return NULL;
+}
+
+// commit the earliest queued frame, both streams must have a frame 
+// queued unless draining. 0 if committed, 1 if none, -1 on error.
+static int mux_frame(int drain)
+{
+	int hasAudio = (mdesc.adesc.audio_type != NMS_AC_NO_AUDIO);
+	int hasVideo = (mdesc.vdesc.video_type != NMS_VC_NO_VIDEO);
+	media_buf_t * a = hasAudio? RecQueuePeek(&audQueue) : NULL;
+	media_buf_t * v = hasVideo? RecQueuePeek(&vidQueue) : NULL;
+	int audio;
+	int status;
+
+	if (!a && !v) return 1;
+	if (hasAudio && hasVideo && (!a || !v) && !drain) return 1;
+
+	if (a && v) StatsAvGap(a->abuf.tsms - v->vbuf.tsms);
+	audio = a && (!v || (a->abuf.tsms <= v->vbuf.tsms));
+	status = avsync_save_frame(audio? a : v, audio, audio? &audQueue : &vidQueue);
+	RecQueuePop(audio? &audQueue : &vidQueue);
+	return status? -1 : 0;
+}
+
+// pre-roll frames are few, copied.
+static int preroll_save_frame(media_buf_t * mbuf, int audio)
+{
+	return avsync_save_frame(mbuf, audio, NULL);
+}
+
+static void * muxLoop( void * arg )
+{
+	int status = 0;
+
+	while (!status)
 	{
-		fd=open(PROC_AUDIO_ENC_PID, O_RDONLY, 0);
-		if (fd!=-1)
-		{
-			memset(buf,0,PID_LEN);
-			read(fd, buf, PID_LEN-1);
-			pid=atoi(buf);
-			if (pid!=-1)
-			{
-				sched_getparam(pid, &nmsd_param);
-				nmsd_param.sched_priority=0;
-				sched_setscheduler(pid, SCHED_RR,&nmsd_param);
-			}
-			close(fd);
-		}
+		sem_wait(&muxSem);
+		if (!is_going()) break;
+		while (0 == (status = mux_frame(0)));
+		if (status > 0) status = 0;
 	}
-	fd=open(PROC_IRESIZE_PID, O_RDONLY, 0);
-	if (fd!=-1)
+
+	// capture threads see going cleared and leave, commit what they left.
+	EngineWait(ENGINE_REC_AUDIO);
+	EngineWait(ENGINE_REC_VIDEO);
+	if (!status) 
+		while (0 == (status = mux_frame(1)));
+	DBGLOG("mux thread exited, %d audio %d video frames left.", 
+		   RecQueueCount(&audQueue), RecQueueCount(&vidQueue));
+
+	// plugin is finished only once everything queued is written.
 	{
-		memset(buf,0,PID_LEN);
-		read(fd, buf, PID_LEN-1);
-		pid=atoi(buf);
-		if (pid!=-1)
-		{
-			sched_getparam(pid, &nmsd_param);
-			nmsd_param.sched_priority=0;
-			sched_setscheduler(pid, SCHED_RR,&nmsd_param);
-		}
-		close(fd);
+		int commitret = WriterStop(status >= 0);
+
+		if (commitret && (status >= 0)) commit_failed(commitret);
 	}
+
+	stop_server();
+	StatsSummary();
+	return NULL;
 }
 
-static void increase_imedia_thread_prio(void)
+static pid_t read_imedia_pid(const char * path)
 {
-	int pid;
 	char buf[PID_LEN];
-	struct sched_param nmsd_param;
-	int fd=-1;
-	if (mdesc.vdesc.video_type != NMS_AC_NO_AUDIO)
-	{
-		fd=open(PROC_AUDIO_ENC_PID, O_RDONLY, 0);
-		if (fd!=-1)
-		{
-			memset(buf,0,PID_LEN);
-			read(fd, buf, PID_LEN-1);
-			pid=atoi(buf);
-			if (pid!=-1)
-			{
-				sched_getparam(pid, &nmsd_param);
-				nmsd_param.sched_priority=ENC_AUDIO_THREAD_PRIORITY;
-				sched_setscheduler(pid, SCHED_RR,&nmsd_param);
-			}
-			close(fd);
-		}
-	}
-	fd=open(PROC_IRESIZE_PID, O_RDONLY, 0);
+	int fd;
+	pid_t pid = -1;
+
+	fd=open(path, O_RDONLY, 0);
 	if (fd!=-1)
 	{
 		memset(buf,0,PID_LEN);
-		read(fd, buf, PID_LEN-1);
-		pid=atoi(buf);
-		if (pid!=-1)
-		{
-			sched_getparam(pid, &nmsd_param);
-			nmsd_param.sched_priority=IRESIZE_THREAD_PRIORITY;
-			sched_setscheduler(pid, SCHED_RR,&nmsd_param);
-		}
+		if (read(fd, buf, PID_LEN-1) > 0) pid=atoi(buf);
 		close(fd);
 	}
+	return pid;
+}
+
+static void revert_imedia_thread_prio(void)
+{
+	SchedRestore(SR_ENC_AUDIO);
+	SchedRestore(SR_ENC_RESIZE);
+}
+
+static void increase_imedia_thread_prio(void)
+{
+	if (mdesc.vdesc.video_type != NMS_AC_NO_AUDIO)
+		SchedApplyPid(SR_ENC_AUDIO, read_imedia_pid(PROC_AUDIO_ENC_PID));
+	SchedApplyPid(SR_ENC_RESIZE, read_imedia_pid(PROC_IRESIZE_PID));
 }
 
 /**
@@ -591,6 +670,7 @@ NMS_SRV_RECORD_ERROR
 SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 {
 	int pluginret;
+	unsigned int budget;
 
 	DBGLOG("Target file name: %s", fname);
 
@@ -600,6 +680,10 @@ SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 
 	LOCK_RMUTEX();
 	recordingSize = 0;
+	segmentSize = 0;
+	segmentStart = 0;
+	outputFinished = 0;
+	memcpy(&segCtrl, ctrl, sizeof(rec_ctrl_t));
 
 	// Reset last error info. This information is never changed in this function, only later during recording.
 	lastRecErrorDetail.error = NMS_RECORD_OK;
@@ -654,7 +738,8 @@ SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 		of the recording. At each a/v sync we will check this value before committing the
 		data to disk to ensure we meet this finalization requirement. Please notice that we expect
 		that nothing else is writing to disk while we perform a recording, aside for the plugin itself --nerochiaro
-		TODO: to relax the above assumption, this can be modified to fetch again the free disk space at each N commits, if it's not too much overhead
+		Free space is refreshed in background while recording, so others writing to the disk are 
+		accounted, see server-rec-space.c.
 	*/
 
 	//NOTE: we are assuming the file on disk was already created. if not, this will fail.
@@ -685,6 +770,9 @@ SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 		goto bail1;
 	}
 
+	// Space is reserved ahead from now on, free space figures count it as ours.
+	PreallocStart(fname, expected_kbps(&mdesc));
+
 	LOCK_RMUTEX();
 	//initialScratchReq = requirements.disk_scratch_space;
 
@@ -694,34 +782,13 @@ SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 	stopped = RECORDER_RUNNING;
 	paused = 0;
 	going  = 1;
-	audReady = 1;
-	vidReady = 1;
 	UNLOCK_RMUTEX();
 
-	if (mdesc.adesc.audio_type != NMS_AC_NO_AUDIO)
-	{
-		if (pthread_create(&audThread, NULL, audLoop, NULL))
-		{
-			WARNLOG("Audio thread was not created!");
-			details->message = 3;
-			goto bail1;
-		}
-   }
-	if (pthread_create(&vidThread, NULL, vidLoop, NULL))
-	{
-		WARNLOG("Video thread was not created!");
-		details->message = 4;
-		goto bail1;
-	}
-
 	// Prepare to start.
-	LOCK_RMUTEX();
-
 	pluginret = EncInputInit(&mdesc, OutputGetMode()); //TODO: input plugins should return more detailed error codes
 	if (pluginret != 0)
 	{
 		WARNLOG("Unable to init encoder input!");
-		UNLOCK_RMUTEX();
 		details->source = SRC_PLUG_INP_INIT;
 		details->message = pluginret;
 		goto bail1;
@@ -733,35 +800,89 @@ SrvRecord( rec_ctrl_t * ctrl, char * fname, NMS_SRV_ERROR_DETAIL *details )
 	if (pluginret != 0)
 	{
 		WARNLOG("Unable to start encoder input!");
-		UNLOCK_RMUTEX();
 		details->source = SRC_PLUG_INP_INIT;
 		details->message = pluginret;
 		goto bail2;
 	}
 	DBGLOG("Encoder input started.");
 
-	// Initialization done, now go!
-	audReady = 0;
+	SpaceReset(diskFreeSpace);
+	StatsReset();
 
-	// video thread don't care if video is not available.
-	if (mdesc.vdesc.video_type != NMS_VC_NO_VIDEO) vidReady = 0;
-	
+	// Initialization done, now go! Mux first, it finishes the plugins
+	// once any of the threads fails.
+	RecQueueInit(&audQueue, 1);
+	RecQueueInit(&vidQueue, 0);
+	sem_init(&muxSem, 0, 0);
+	muxSemInited = 1;
+	LOCK_RMUTEX();
+	budget = writerBudget;
 	UNLOCK_RMUTEX();
-	pthread_cond_broadcast(&recordCond);
+	if (WriterStart(budget))
+	{
+		WARNLOG("Writer thread was not created!");
+		details->message = 6;
+		goto bail2;
+	}
+	// monitor video kept from before goes first, live frames follow it.
+	if (mdesc.vdesc.video_type != NMS_VC_NO_VIDEO)
+	{
+		int length = PrerollFlush(&mdesc, preroll_save_frame);
+
+		LOCK_RMUTEX();
+		timeoffset = -length;
+		UNLOCK_RMUTEX();
+	}
+	if (EngineSubmit(ENGINE_REC_MUX, muxLoop, NULL))
+	{
+		WARNLOG("Mux thread was not created!");
+		details->message = 5;
+		WriterStop(0);
+		goto bail2;
+	}
+	if ((mdesc.adesc.audio_type != NMS_AC_NO_AUDIO) &&
+		EngineSubmit(ENGINE_REC_AUDIO, audLoop, NULL))
+	{
+		WARNLOG("Audio thread was not created!");
+		details->message = 3;
+		goto bail3;
+	}
+	if ((mdesc.vdesc.video_type != NMS_VC_NO_VIDEO) &&
+		EngineSubmit(ENGINE_REC_VIDEO, vidLoop, NULL))
+	{
+		WARNLOG("Video thread was not created!");
+		details->message = 4;
+		goto bail3;
+	}
+	if (SpaceStart(fname))
+		WARNLOG("Free space monitor not started, checking against space at start.");
+	if (SegmentStart(fname))
+		WARNLOG("Next segment not prepared, recording stops at segment limits.");
 
 	increase_imedia_thread_prio();
 
+	LOCK_RMUTEX();
+	recordings++;
+	UNLOCK_RMUTEX();
+
 	details->error = NMS_RECORD_OK;
 	return details->error;
 
+bail3:
+	// mux finishes plugins itself.
+	SrvStopRecord();
+	return details->error;
 bail2:
 	EncInputFinish();
 bail1:
 	EncOutputFinish(); //don't care of the return here, we're bailing out anyway 
+	PreallocStop();
 bail:
 
 	LOCK_RMUTEX();
 	going = 0;
+	// already cleaned up, loops must not finish plugins again.
+	stopped = RECORDER_STOPPED;
 	UNLOCK_RMUTEX();
 
 	return details->error;
@@ -784,8 +905,6 @@ SrvPauseRecord( int p )
 			paused = RECORDER_TO_UNPAUSE;
 	}
 	UNLOCK_RMUTEX();
-
-	pthread_cond_broadcast(&recordCond);
 }
 
 /**
@@ -794,26 +913,31 @@ SrvPauseRecord( int p )
 void
 SrvStopRecord( void )
 {
+	int length;
+
     LOCK_RMUTEX();
 	going = 0;
 	UNLOCK_RMUTEX();
-	pthread_cond_broadcast(&recordCond);
+	if (muxSemInited) sem_post(&muxSem);
 
-	if (audThread)
-	{
-		DBGLOG("Removing audio thread!");
-		pthread_join(audThread, NULL);
-		audThread = (pthread_t)NULL;
-		DBGLOG("Audio thread removed!");
-	}
+	// mux waits for capture threads and drains their queues.
+	DBGLOG("Waiting for mux loop!");
+	EngineWait(ENGINE_REC_MUX);
+	DBGLOG("Mux loop finished!");
+
+	SpaceStop();
+	LOCK_RMUTEX();
+	length = timestamp - segmentStart;
+	UNLOCK_RMUTEX();
+	SegmentStop(length);
+
+	DBGLOG("Waiting for audio loop!");
+	EngineWait(ENGINE_REC_AUDIO);
+	DBGLOG("Audio loop finished!");
 	
-	if (vidThread)
-	{
-		DBGLOG("Removing video thread!");
-		pthread_join(vidThread, NULL);
-		vidThread = (pthread_t)NULL;
-		DBGLOG("Video thread removed!");
-	}
+	DBGLOG("Waiting for video loop!");
+	EngineWait(ENGINE_REC_VIDEO);
+	DBGLOG("Video loop finished!");
 	revert_imedia_thread_prio();
 }
 
@@ -867,12 +991,26 @@ SrvGetRecordtime( void )
  * Get current record file size.
  *
  * @return
- *         record file size in byte.
+ *         record size in byte over all segments, UINT_MAX if larger.
  */
 unsigned int
 SrvGetRecordsize(void)
 {
-	unsigned int loc_recordingSize;
+	unsigned long long loc_recordingSize = SrvGetRecordsize64();
+
+	return (loc_recordingSize > UINT_MAX)? UINT_MAX : loc_recordingSize;
+}
+
+/**
+ * Get current record size over all segments.
+ *
+ * @return
+ *         record size in byte.
+ */
+unsigned long long
+SrvGetRecordsize64(void)
+{
+	unsigned long long loc_recordingSize;
 
 	LOCK_RMUTEX();
 	loc_recordingSize = recordingSize;
@@ -881,6 +1019,23 @@ SrvGetRecordsize(void)
 	return loc_recordingSize;
 }
 
+/**
+ * Get segments of current or last recording.
+ *
+ * @param info
+ *        info buffer.
+ */
+void
+SrvGetRecordSegments( rec_segment_info_t * info )
+{
+	SegmentGetInfo(info);
+	LOCK_RMUTEX();
+	info->totalBytes = recordingSize;
+	info->segmentBytes = segmentSize;
+	info->segmentSeconds = (timestamp - segmentStart) / 1000;
+	UNLOCK_RMUTEX();
+}
+
 /**
  * Get last recording error status
  *
@@ -895,6 +1050,56 @@ SrvGetRecordError(NMS_SRV_ERROR_DETAIL * details)
 	UNLOCK_RMUTEX();
 }
 
+/**
+ * Get write-behind statistics of current or last recording.
+ *
+ * @param stats
+ *        statistics buffer.
+ */
+void
+SrvGetRecordWriterStats( rec_writer_stats_t * stats )
+{
+	WriterGetStats(stats);
+}
+
+/**
+ * Set memory budget of recording write-behind, from next recording on.
+ *
+ * @param bytes
+ *        bytes that may be queued for writing, 0 for default.
+ */
+void
+SrvSetRecordWriterBudget( unsigned int bytes )
+{
+	LOCK_RMUTEX();
+	writerBudget = bytes;
+	UNLOCK_RMUTEX();
+}
+
+/**
+ * Get free space of recording disk and how fast it fills.
+ *
+ * @param info
+ *        info buffer, secondsLeft tells recording time left.
+ */
+void
+SrvGetRecordSpace( rec_space_info_t * info )
+{
+	SpaceGetInfo(info);
+}
+
+/**
+ * Get frame, latency and throughput statistics of current or last recording.
+ *
+ * @param stats
+ *        statistics buffer.
+ */
+void
+SrvGetRecordStats( rec_stats_t * stats )
+{
+	StatsGet(stats);
+}
+
 /**
  * Tell if server is recording.
  *
@@ -913,3 +1118,43 @@ SrvIsRecording( void )
 	return loc_going;
 }
 
+/**
+ * Count recordings started, so whoever started one can tell it is still
+ * the one going.
+ *
+ * @return
+ *         recordings started since server start.
+ */
+unsigned int
+SrvGetRecordCount( void )
+{
+	unsigned int count;
+
+	LOCK_RMUTEX();
+	count = recordings;
+	UNLOCK_RMUTEX();
+
+	return count;
+}
+
+/**
+ * Take recorder control. Recordings and the monitor sharing their capture
+ * are started, paused and stopped holding it, by the command thread and
+ * recording timers alike, so the recorder state checked holds till acted
+ * upon.
+ */
+void
+SrvLockRecorder( void )
+{
+	pthread_mutex_lock(&controlMutex);
+}
+
+/**
+ * Release recorder control.
+ */
+void
+SrvUnlockRecorder( void )
+{
+	pthread_mutex_unlock(&controlMutex);
+}
+
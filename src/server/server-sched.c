@@ -0,0 +1,327 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms thread scheduling policy.
+ *
+ * Every thread role gets its policy, priority and CPU affinity from one 
+ * table, defaults may be overridden per deployment in SCHED_CONFIG_FILE,
+ * one role per line:
+ *
+ *     <role> <policy> <priority> [<cpu mask>]
+ *
+ * policy being one of "other", "fifo", "rr" or "-" to leave the thread
+ * as it is, cpu mask in hex, 0 or none for any CPU. Lines starting with 
+ * '#' are ignored. Scheduling in effect before applying is kept per role
+ * and put back on restore, the threads outside nmsd must not be left 
+ * with real-time priority once nmsd is done with them.
+ *
+ * REVISION:
+ * 
+ * 2) Recording timers start on time under load. ---------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-nms.h"
+#include "server-sched.h"
+
+#define POLICY_INHERIT   -1
+
+typedef struct
+{
+	const char *       name;
+	int                policy;
+	int                priority;
+	unsigned int       cpus;     // affinity mask, 0 for any.
+
+	pid_t              tid;      // thread applied to, 0 if none.
+	int                error;    // errno of last apply.
+	int                saved;    // previous scheduling below is valid.
+	int                oldPolicy;
+	struct sched_param oldParam;
+#ifdef CPU_ZERO
+	int                oldCpusValid;
+	cpu_set_t          oldCpus;
+#endif
+} sched_role_t;
+
+// defaults are what the server always used.
+static sched_role_t roles[SR_ROLES] =
+{
+	{ "playback",   POLICY_INHERIT, 0,  0 },
+	{ "next-file",  POLICY_INHERIT, 0,  0 },
+	{ "dir-init",   POLICY_INHERIT, 0,  0 },
+	{ "rec-audio",  SCHED_RR,       1,  0 },
+	{ "rec-video",  SCHED_RR,       1,  0 },
+	{ "rec-mux",    SCHED_RR,       1,  0 },
+	{ "monitor",    POLICY_INHERIT, 0,  0 },
+	{ "writer",     POLICY_INHERIT, 0,  0 },
+	{ "rec-space",  POLICY_INHERIT, 0,  0 },
+	{ "rec-segment", POLICY_INHERIT, 0, 0 },
+	{ "rec-timer",  SCHED_RR,       10, 0 },
+	{ "command",    POLICY_INHERIT, 0,  0 },
+	{ "enc-audio",  SCHED_RR,       99, 0 },
+	{ "enc-resize", SCHED_RR,       80, 0 },
+};
+
+static pthread_mutex_t    schedMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define LOCK_SCHEDMUTEX()   pthread_mutex_lock(&schedMutex)
+#define UNLOCK_SCHEDMUTEX() pthread_mutex_unlock(&schedMutex)
+
+static int parsePolicy( const char * s )
+{
+	if (!strcmp(s, "other")) return SCHED_OTHER;
+	if (!strcmp(s, "fifo")) return SCHED_FIFO;
+	if (!strcmp(s, "rr")) return SCHED_RR;
+	if (!strcmp(s, "-")) return POLICY_INHERIT;
+	return -2;
+}
+
+static void loadConfig( void )
+{
+	FILE * fp;
+	char line[128];
+	char name[32];
+	char policy[16];
+	int priority;
+	unsigned int cpus;
+	int n;
+	int ii;
+
+	fp = fopen(SCHED_CONFIG_FILE, "r");
+	if (!fp) return;
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		if ((line[0] == '#') || (line[0] == '\n')) continue;
+
+		cpus = 0;
+		n = sscanf(line, "%31s %15s %d %x", name, policy, &priority, &cpus);
+		if (n < 3)
+		{
+			WPRINT("bad scheduling line: %s", line);
+			continue;
+		}
+		for (ii = 0; ii < SR_ROLES; ii++)
+			if (!strcmp(name, roles[ii].name)) break;
+		if ((ii == SR_ROLES) || (parsePolicy(policy) == -2))
+		{
+			WPRINT("bad scheduling line: %s", line);
+			continue;
+		}
+		roles[ii].policy = parsePolicy(policy);
+		roles[ii].priority = priority;
+		roles[ii].cpus = cpus;
+		DBGLOG("scheduling %s: policy %d, priority %d, cpus 0x%x.", 
+			   name, roles[ii].policy, priority, cpus);
+	}
+	fclose(fp);
+}
+
+// apply role to tid, schedMutex held.
+static void apply( sched_role_t * r, pid_t tid )
+{
+	struct sched_param param;
+
+	if (r->saved && (r->tid != tid))
+	{
+		// role moved on to another thread, leave the old one as it was.
+		r->saved = 0;
+	}
+	r->tid = tid;
+	r->error = 0;
+
+	if (!r->saved)
+	{
+		r->oldPolicy = sched_getscheduler(tid);
+		r->saved = (r->oldPolicy >= 0) && !sched_getparam(tid, &r->oldParam);
+#ifdef CPU_ZERO
+		r->oldCpusValid = !sched_getaffinity(tid, sizeof(cpu_set_t), &r->oldCpus);
+#endif
+	}
+
+	if (r->policy != POLICY_INHERIT)
+	{
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = r->priority;
+		if (sched_setscheduler(tid, r->policy, &param))
+		{
+			r->error = errno;
+			WPRINT("unable to schedule %s (%d): %s", r->name, tid, strerror(errno));
+		}
+	}
+
+#ifdef CPU_ZERO
+	if (r->cpus)
+	{
+		cpu_set_t set;
+		int cpu;
+
+		CPU_ZERO(&set);
+		for (cpu = 0; cpu < 32; cpu++)
+			if (r->cpus & (1u << cpu)) CPU_SET(cpu, &set);
+		if (sched_setaffinity(tid, sizeof(cpu_set_t), &set))
+		{
+			r->error = errno;
+			WPRINT("unable to set %s (%d) affinity: %s", r->name, tid, strerror(errno));
+		}
+	}
+#endif
+}
+
+// put back scheduling role found, schedMutex held.
+static void restore( sched_role_t * r )
+{
+	if (!r->saved) return;
+
+	if ((r->policy != POLICY_INHERIT) && 
+		sched_setscheduler(r->tid, r->oldPolicy, &r->oldParam))
+		WPRINT("unable to restore %s (%d): %s", r->name, r->tid, strerror(errno));
+#ifdef CPU_ZERO
+	if (r->cpus && r->oldCpusValid)
+		sched_setaffinity(r->tid, sizeof(cpu_set_t), &r->oldCpus);
+#endif
+	r->saved = 0;
+}
+
+/**
+ * Load scheduling configuration.
+ */
+void
+SchedInit( void )
+{
+	LOCK_SCHEDMUTEX();
+	loadConfig();
+	UNLOCK_SCHEDMUTEX();
+}
+
+/**
+ * Apply role scheduling to calling thread.
+ *
+ * @param role
+ *        thread role.
+ */
+void
+SchedApply( SCHED_ROLE role )
+{
+	SchedApplyPid(role, syscall(SYS_gettid));
+}
+
+/**
+ * Apply role scheduling to given thread or process.
+ *
+ * @param role
+ *        thread role.
+ * @param pid
+ *        thread or process id.
+ */
+void
+SchedApplyPid( SCHED_ROLE role, pid_t pid )
+{
+	if (pid <= 0) return;
+
+	LOCK_SCHEDMUTEX();
+	apply(&roles[role], pid);
+	UNLOCK_SCHEDMUTEX();
+}
+
+/**
+ * Put back scheduling in effect before role was applied.
+ *
+ * @param role
+ *        thread role.
+ */
+void
+SchedRestore( SCHED_ROLE role )
+{
+	LOCK_SCHEDMUTEX();
+	restore(&roles[role]);
+	UNLOCK_SCHEDMUTEX();
+}
+
+/**
+ * Put back scheduling of every role, on exit.
+ */
+void
+SchedRestoreAll( void )
+{
+	int ii;
+
+	LOCK_SCHEDMUTEX();
+	for (ii = 0; ii < SR_ROLES; ii++) restore(&roles[ii]);
+	UNLOCK_SCHEDMUTEX();
+}
+
+/**
+ * Report configured and effective scheduling of every role.
+ *
+ * @param info
+ *        report buffer.
+ * @param max
+ *        number of entries info holds.
+ * @return
+ *        number of entries filled.
+ */
+int
+SchedGetInfo( sched_role_info_t * info, int max )
+{
+	struct sched_param param;
+	sched_role_t * r;
+	int ii;
+
+	LOCK_SCHEDMUTEX();
+	for (ii = 0; (ii < SR_ROLES) && (ii < max); ii++)
+	{
+		r = &roles[ii];
+		memset(&info[ii], 0, sizeof(sched_role_info_t));
+		strncpy(info[ii].name, r->name, sizeof(info[ii].name) - 1);
+		info[ii].tid = r->tid;
+		info[ii].policy = r->policy;
+		info[ii].priority = r->priority;
+		info[ii].cpus = r->cpus;
+		info[ii].error = r->error;
+		info[ii].curPolicy = -1;
+		if (r->tid > 0)
+		{
+			info[ii].curPolicy = sched_getscheduler(r->tid);
+			if (!sched_getparam(r->tid, &param)) 
+				info[ii].curPriority = param.sched_priority;
+		}
+	}
+	UNLOCK_SCHEDMUTEX();
+	return ii;
+}
@@ -0,0 +1,66 @@
+#ifndef NMS_SERVER_SCHED__H
+#define NMS_SERVER_SCHED__H
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms thread scheduling policy header.
+ *
+ * REVISION:
+ * 
+ * 
+ * 2) Added recording timer role. ------------------------- 2026-10-19
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <sys/types.h>
+
+#define SCHED_CONFIG_FILE  "/etc/nms-sched.conf"
+
+/// thread roles scheduling is configured for.
+typedef enum
+	{
+		SR_PLAYBACK,        // playback a/v loop.
+		SR_NEXT_FILE,       // directory/playlist next file loop.
+		SR_DIR_INIT,        // directory listing.
+		SR_REC_AUDIO,       // recording audio loop.
+		SR_REC_VIDEO,       // recording video loop.
+		SR_REC_MUX,         // recording mux loop.
+		SR_MONITOR,         // monitor loop.
+		SR_WRITER,          // recording writer.
+		SR_REC_SPACE,       // recording free space monitor.
+		SR_REC_SEGMENT,     // recording next segment preparation.
+		SR_REC_TIMER,       // recording timers.
+		SR_COMMAND,         // command loop.
+		SR_ENC_AUDIO,       // imedia audio encoder, outside nmsd.
+		SR_ENC_RESIZE,      // imedia resizer, outside nmsd.
+		SR_ROLES
+	} SCHED_ROLE;
+
+void SchedInit(void);
+void SchedApply(SCHED_ROLE);
+void SchedApplyPid(SCHED_ROLE, pid_t);
+void SchedRestore(SCHED_ROLE);
+void SchedRestoreAll(void);
+int  SchedGetInfo(sched_role_info_t *, int);
+
+#endif /* NMS_SERVER_SCHED__H */
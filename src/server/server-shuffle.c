@@ -0,0 +1,211 @@
+/*
+ *  Copyright(C) 2006 Neuros Technology International LLC. 
+ *               <www.neurostechnology.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ *  
+ *
+ *  This program is distributed in the hope that, in addition to its 
+ *  original purpose to support Neuros hardware, it will be useful 
+ *  otherwise, but WITHOUT ANY WARRANTY; without even the implied 
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ ****************************************************************************
+ *
+ * Neuros-Cooler platform nms shuffle order.
+ *
+ * Shuffle order is a permutation of all track indexes, computed one index
+ * at a time by a small Feistel network over the smallest power of 4 range
+ * holding all tracks; indexes falling outside are walked through the 
+ * network again until they land inside. Every track thus plays once per
+ * round, with no per-track state. A new round takes a new seed. 
+ *
+ * Tracks played are kept in a bounded ring so "previous" retraces them,
+ * and "next" after "previous" walks forward again before going on. The 
+ * seed and round position are all that is needed to resume the order.
+ *
+ * Callers serialise access, playback holds its own mutex.
+ *
+ * REVISION:
+ * 
+ * 1) Initial creation. ----------------------------------- 2026-10-19
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+//#define OSD_DBG_MSG
+#include "nc-err.h"
+
+#include "server-shuffle.h"
+
+#define ROUNDS         4
+
+static unsigned int       seed;
+static int                pos;        // position in current round.
+static int                ring[SHUFFLE_HISTORY];
+static int                ringHead;   // next slot to write.
+static int                ringFill;
+static int                back;       // steps gone back with "previous".
+
+static unsigned int mix( unsigned int x )
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+static unsigned int feistel( unsigned int x, int half, unsigned int key )
+{
+	unsigned int mask = (1u << half) - 1;
+	unsigned int l = x >> half;
+	unsigned int r = x & mask;
+	unsigned int t;
+	int ii;
+
+	for (ii = 0; ii < ROUNDS; ii++)
+	{
+		t = r;
+		r = l ^ (mix(r ^ key ^ (ii * 0x9e3779b9)) & mask);
+		l = t;
+	}
+	return (l << half) | r;
+}
+
+// pos-th index of round seeded with key, over n tracks.
+static int permute( int p, int n, unsigned int key )
+{
+	unsigned int x = p;
+	int half = 1;
+
+	while ((1u << (2 * half)) < (unsigned int)n) half++;
+	do x = feistel(x, half, key);
+	while (x >= (unsigned int)n);
+	return x;
+}
+
+static void push( int idx )
+{
+	ring[ringHead] = idx;
+	ringHead = (ringHead + 1) % SHUFFLE_HISTORY;
+	if (ringFill < SHUFFLE_HISTORY) ringFill++;
+}
+
+static int peek( int steps )
+{
+	return ring[(ringHead + SHUFFLE_HISTORY - 1 - steps) % SHUFFLE_HISTORY];
+}
+
+/**
+ * Start a shuffle order.
+ *
+ * @param s
+ *        seed of a saved order, 0 for a new order.
+ * @param p
+ *        position in saved order.
+ */
+void
+ShuffleReset( unsigned int s, int p )
+{
+	static unsigned int count;
+
+	if (!s) s = mix((unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ ++count);
+	seed = s? s : 1;
+	pos = (p > 0)? p : 0;
+	ringHead = ringFill = back = 0;
+}
+
+/**
+ * Note the track playing when shuffle takes over, "previous" returns to it.
+ *
+ * @param idx
+ *        track index.
+ */
+void
+ShuffleSeen( int idx )
+{
+	if (!ringFill) push(idx);
+}
+
+/**
+ * Get next track.
+ *
+ * @param n
+ *        number of tracks.
+ * @return
+ *        track index, -1 if there is no track.
+ */
+int
+ShuffleNext( int n )
+{
+	int idx;
+
+	if (n <= 0) return -1;
+
+	// forward again over tracks gone back on.
+	while (back > 0)
+	{
+		idx = peek(--back);
+		if (idx < n) return idx;
+	}
+
+	if (pos >= n)
+	{
+		// every track played, start a new round.
+		seed = mix(seed) | 1;
+		pos = 0;
+	}
+	idx = permute(pos++, n, seed);
+	push(idx);
+	return idx;
+}
+
+/**
+ * Get previous track.
+ *
+ * @param n
+ *        number of tracks.
+ * @return
+ *        track index, -1 if no track to go back to.
+ */
+int
+ShufflePrev( int n )
+{
+	int idx;
+
+	while (back + 1 < ringFill)
+	{
+		idx = peek(++back);
+		if (idx < n) return idx;
+	}
+	return -1;
+}
+
+/**
+ * Get state to resume shuffle order with.
+ *
+ * @param s
+ *        seed.
+ * @param p
+ *        position.
+ */
+void
+ShuffleGetState( unsigned int * s, int * p )
+{
+	*s = seed;
+	*p = pos;
+}